@@ -0,0 +1,110 @@
+#include "algorithms.h"
+#include "binary_tree.h"
+#include "eller.h"
+#include "mazefile.h"
+#include "sidewinder.h"
+#include "stats.h"
+#include <stdlib.h> // malloc(), free()
+#include <string.h> // strcmp()
+
+// Depth first search from a random cell, as `gen_maze_4()` does
+static void carve_dfs(struct maze* maze, unsigned long limit, struct rng* rng, step_func_t write_step, void* step_ctx) {
+    unsigned long start_coords[GRID_MAX_DIMS];
+    for (unsigned d = 0; d < maze->dims; d++) {
+        start_coords[d] = (unsigned long)rng_below(rng, maze->dims_array[d]);
+    }
+    gen_grid(maze, cell_index(maze, start_coords), limit, rng, write_step, step_ctx);
+}
+
+// The row at a time generators, behind `void*`s
+static void* new_eller_rows(unsigned long rows, unsigned long cols, struct rng* rng) {
+    return new_eller(rows, cols, rng);
+}
+static void eller_rows_deallocate(void* rows) {
+    eller_deallocate(rows);
+}
+static void* new_binary_tree_rows(unsigned long rows, unsigned long cols, struct rng* rng) {
+    return new_binary_tree(rows, cols, rng);
+}
+static void binary_tree_rows_deallocate(void* rows) {
+    binary_tree_deallocate(rows);
+}
+static void* new_sidewinder_rows(unsigned long rows, unsigned long cols, struct rng* rng) {
+    return new_sidewinder(rows, cols, rng);
+}
+static void sidewinder_rows_deallocate(void* rows) {
+    sidewinder_deallocate(rows);
+}
+
+static const struct maze_algorithm algorithms[] = {
+    { "dfs", MAZEFILE_ALGORITHM_DFS, MAZEFILE_MAX_DIMS, carve_dfs, NULL, NULL, NULL, NULL },
+    { "prim", MAZEFILE_ALGORITHM_PRIM, GRID_MAX_DIMS, carve_prim, NULL, NULL, NULL, NULL },
+    { "wilson", MAZEFILE_ALGORITHM_WILSON, GRID_MAX_DIMS, carve_wilson, NULL, NULL, NULL, NULL },
+    { "hunt-and-kill", MAZEFILE_ALGORITHM_HUNT_AND_KILL, GRID_MAX_DIMS, carve_hunt_and_kill, NULL, NULL, NULL, NULL },
+    { "kruskal", MAZEFILE_ALGORITHM_KRUSKAL, GRID_MAX_DIMS, carve_kruskal, NULL, NULL, NULL, carve_kruskal_threads },
+    { "binary-tree", MAZEFILE_ALGORITHM_BINARY_TREE, 2, NULL,
+        new_binary_tree_rows, binary_tree_next_row, binary_tree_rows_deallocate, NULL },
+    { "sidewinder", MAZEFILE_ALGORITHM_SIDEWINDER, 2, NULL,
+        new_sidewinder_rows, sidewinder_next_row, sidewinder_rows_deallocate, NULL },
+    { "eller", MAZEFILE_ALGORITHM_ELLER, 2, NULL,
+        new_eller_rows, eller_next_row, eller_rows_deallocate, NULL },
+};
+
+const struct maze_algorithm* find_maze_algorithm(const char* name) {
+    for (size_t i = 0; i < sizeof(algorithms) / sizeof(algorithms[0]); i++) {
+        if (strcmp(algorithms[i].name, name) == 0) return &algorithms[i];
+    }
+    return NULL;
+}
+
+/**
+ * Carve the rows of a row at a time algorithm into a two dimensional grid
+ * Each cell is a step, and `limit` stops it early like any other algorithm.
+ */
+static void carve_rows(const struct maze_algorithm* algorithm, struct maze* maze, unsigned long limit, struct rng* rng,
+        step_func_t write_step, void* step_ctx) {
+    unsigned long rows = maze->dims_array[0], cols = maze->dims_array[1];
+    grid_cell_t* grid = maze->grid;
+    void* source = algorithm->new_rows(rows, cols, rng);
+    unsigned char* row = stats_malloc(cols);
+
+    unsigned int step = 0;
+    if (write_step) write_step(step_ctx, maze, NO_CELL, step++);
+    unsigned long steps = 0;
+    for (unsigned long r = 0; r < rows && !(limit && steps >= limit); r++) {
+        algorithm->next_row(source, row);
+        for (unsigned long c = 0; c < cols && !(limit && steps >= limit); c++, steps++) {
+            unsigned long index = r * cols + c;
+            grid[index] |= GRID_VISITED;
+            if (row[c] & ROW_EAST) {
+                grid[index] |= GRID_PASSAGE(DIR_PLUS(1));
+                grid[index + 1] |= GRID_PASSAGE(DIR_MINUS(1));
+            }
+            if (row[c] & ROW_SOUTH) {
+                grid[index] |= GRID_PASSAGE(DIR_PLUS(0));
+                grid[index + cols] |= GRID_PASSAGE(DIR_MINUS(0));
+            }
+            if (write_step) write_step(step_ctx, maze, index, step++);
+        }
+    }
+    if (write_step) write_step(step_ctx, maze, NO_CELL, step++);
+
+    stats_free(row);
+    algorithm->rows_deallocate(source);
+}
+
+struct maze* gen_maze_with(const struct maze_algorithm* algorithm, unsigned dims, unsigned long* dims_array,
+        unsigned long limit, struct rng* rng, step_func_t write_step, void* step_ctx) {
+    if (dims > algorithm->max_dims) return NULL;
+    // Too many dimensions for a grid, so only dfs gets here
+    if (dims > GRID_MAX_DIMS) return gen_maze_nd(dims, dims_array, limit, rng, write_step, step_ctx);
+
+    struct maze* maze = alloc_grid(dims, dims_array);
+    if (!maze) return NULL;
+    if (algorithm->carve) {
+        algorithm->carve(maze, limit, rng, write_step, step_ctx);
+    } else {
+        carve_rows(algorithm, maze, limit, rng, write_step, step_ctx);
+    }
+    return maze;
+}
@@ -0,0 +1,130 @@
+#ifndef MAZE_GEN_ALGORITHMS_H
+#define MAZE_GEN_ALGORITHMS_H
+
+#include "generator.h"
+#include "raster.h" // row_source_t
+
+/*
+ * The generation algorithms, by name
+ *
+ * Algorithms either carve a grid maze from `alloc_grid()` in place, like
+ * `gen_grid()`, or generate a two dimensional maze a row at a time, like
+ * `eller_t`. Row at a time algorithms only hold the current row, so they can
+ * stream mazes of any height. Either way, progress is reported through a
+ * `step_func_t`: once with `NO_CELL` before starting, once per step with the
+ * cell just worked on, and once with `NO_CELL` when done.
+ */
+
+/**
+ * Carve a grid maze in place
+ *
+ * Args:
+ * * maze: A grid maze from `alloc_grid()`, all walls
+ * * limit: The most steps to take, or 0 for no limit. Stopping early leaves
+ *   some cells unvisited.
+ * * rng: The source of randomness
+ * * write_step: Called for each step, may be NULL
+ * * step_ctx: Passed to each call of `write_step`
+ */
+typedef void (*carve_func_t)(struct maze* maze, unsigned long limit, struct rng* rng, step_func_t write_step, void* step_ctx);
+
+/**
+ * Carve a grid maze in place on `threads` threads
+ * The maze must not depend on the number of threads.
+ */
+typedef void (*threaded_carve_func_t)(struct maze* maze, struct rng* rng, unsigned threads);
+
+/** Start generating a `rows` by `cols` maze a row at a time */
+typedef void* (*new_rows_func_t)(unsigned long rows, unsigned long cols, struct rng* rng);
+
+struct maze_algorithm {
+    /** Named like the `--algorithm` flag */
+    const char* name;
+    /** Recorded in binary mazes, one of the `MAZEFILE_ALGORITHM_*`s */
+    unsigned id;
+    /** The most dimensions it can generate */
+    unsigned max_dims;
+    /** Carves a grid maze, or NULL if it only generates rows */
+    carve_func_t carve;
+    /** Row at a time generation, or NULLs if it can't */
+    new_rows_func_t new_rows;
+    row_source_t next_row;
+    void (*rows_deallocate)(void* rows);
+    /** Carves on several threads, or NULL if it can't */
+    threaded_carve_func_t carve_threads;
+};
+
+/** Space separated list of the algorithm names */
+#define MAZE_ALGORITHMS "dfs prim wilson hunt-and-kill kruskal binary-tree sidewinder eller"
+
+/** The algorithm used unless another is asked for */
+#define MAZE_DEFAULT_ALGORITHM "dfs"
+
+/**
+ * Look an algorithm up by name
+ *
+ * Return: The algorithm, or NULL if there's none by that name
+ */
+const struct maze_algorithm* find_maze_algorithm(const char* name);
+
+/**
+ * Allocate and generate a maze with `algorithm`
+ *
+ * Row at a time algorithms have their rows carved into a grid. Only dfs can
+ * generate more than `GRID_MAX_DIMS` dimensions, see `gen_maze_nd()`.
+ *
+ * Return: An allocated maze pointer, or NULL if `algorithm` can't generate
+ *   `dims` dimensions or the maze is too big to allocate. Deallocate using
+ *   `clean_maze()`
+ */
+struct maze* gen_maze_with(const struct maze_algorithm* algorithm, unsigned dims, unsigned long* dims_array,
+        unsigned long limit, struct rng* rng, step_func_t write_step, void* step_ctx);
+
+/**
+ * Carve with randomized Prim's algorithm
+ *
+ * Grows the maze from a random cell by repeatedly joining a random cell from
+ * its frontier, the unvisited cells next to it. Makes lots of short dead ends.
+ * The frontier is the only thing allocated.
+ */
+void carve_prim(struct maze* maze, unsigned long limit, struct rng* rng, step_func_t write_step, void* step_ctx);
+
+/**
+ * Carve with Wilson's algorithm
+ *
+ * Joins each cell to the maze with a loop-erased random walk, which picks
+ * uniformly from every possible maze. The walk is kept in the parent bits of
+ * the grid, so nothing is allocated. Slow to start, as the first walks have
+ * to find a tiny maze.
+ */
+void carve_wilson(struct maze* maze, unsigned long limit, struct rng* rng, step_func_t write_step, void* step_ctx);
+
+/**
+ * Carve with the hunt-and-kill algorithm
+ *
+ * A random walk carves until it runs into a dead end, then a scan in cell
+ * order hunts for an unvisited cell next to the maze to carry on from.
+ * Makes long corridors like depth first search, without any backtracking.
+ */
+void carve_hunt_and_kill(struct maze* maze, unsigned long limit, struct rng* rng, step_func_t write_step, void* step_ctx);
+
+/**
+ * Carve with randomized Kruskal's algorithm
+ *
+ * Opens the walls in a random order, skipping any between cells that are
+ * already joined, which a union-find keeps track of. Makes lots of short dead
+ * ends, like Prim's. Takes a few words per cell, for the walls and the
+ * union-find.
+ */
+void carve_kruskal(struct maze* maze, unsigned long limit, struct rng* rng, step_func_t write_step, void* step_ctx);
+
+/**
+ * Carve with randomized Kruskal's algorithm on `threads` threads
+ *
+ * The walls are shuffled in parallel and joined through a lock-free
+ * union-find, a window of walls at a time. Makes the same maze as
+ * `carve_kruskal()` with the same generator, whatever the number of threads.
+ */
+void carve_kruskal_threads(struct maze* maze, struct rng* rng, unsigned threads);
+
+#endif
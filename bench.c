@@ -0,0 +1,608 @@
+#define _POSIX_C_SOURCE 200809L // clock_gettime(), fork(), strdup()
+#define _DEFAULT_SOURCE         // wait4()
+
+/*
+ * Benchmarks for the generator, writers and converters
+ *
+ * Each benchmark runs at each size in its own child process, so peak RSS is
+ * that benchmark's alone. Results are written as JSON, one result per line,
+ * and can be compared against a previous run's results to catch regressions.
+ *
+ * Fast benchmarks are run more times than asked, until their runs add up to
+ * MIN_BENCH_SECONDS, so their percentiles mean something. A slowdown is only a
+ * regression if the new runs are slower than the old ones by the threshold
+ * nearly all of the time, and results faster than MIN_COMPARE_SECONDS are too
+ * noisy to compare at all.
+ */
+
+#include "generator.h"
+#include "maze_writer.h"
+#include "mazefile.h"
+#include "rng.h"
+#include <math.h>   // cbrt()
+#include <stdio.h>
+#include <stdlib.h> // malloc(), free(), qsort(), strtoul()
+#include <string.h> // strcmp(), strrchr(), strstr()
+#include <sys/resource.h>
+#include <sys/stat.h>  // mkdir()
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <time.h>   // clock_gettime()
+#include <unistd.h> // fork(), pipe(), execv()
+
+#ifndef MAZE_VERSION
+#define MAZE_VERSION "unknown"
+#endif
+
+#define DEFAULT_SIZES "100,1000,10000"
+#define DEFAULT_RUNS 5
+#define DEFAULT_THRESHOLD 10.0
+#define DEFAULT_DIR "bench-files"
+// Runs are capped at this above BIG_CELLS cells, so the largest sizes finish
+#define BIG_RUNS 3
+#define BIG_CELLS 10000000ul
+// Linked `struct cell` mazes take ~100 bytes a cell, so stop well short of
+// the largest sizes
+#define LINKED_MAX_CELLS 4000000ul
+#define MAX_RUNS 64
+// Runs are split between this many processes
+#define BENCH_PROCESSES 3
+// Runs are repeated until they've taken at least this long, up to MAX_RUNS
+#define MIN_BENCH_SECONDS 0.2
+// Medians faster than this are a few scheduler time slices, and mostly noise
+#define MIN_COMPARE_SECONDS 0.01
+
+#define SEED 0x6d617a65u
+
+#define USAGE "Usage: %s [--sizes n,n,...] [--runs n] [--out file] [--baseline file] " \
+    "[--threshold percent] [--dir scratch_dir]\n"
+
+/*
+ * Counting allocations
+ *
+ * The bench links with `-Wl,--wrap=malloc` and friends, so every allocation
+ * the maze code makes comes through here. Allocations inside libc and libpng
+ * aren't seen.
+ */
+static unsigned long allocs;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void* __wrap_malloc(size_t size);
+void* __wrap_calloc(size_t count, size_t size);
+void* __wrap_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    allocs++;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    allocs++;
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    if (!ptr) allocs++;
+    return __real_realloc(ptr, size);
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+/*
+ * Timing the part of a run being measured
+ * Allocations are only counted between `timer_start()` and `timer_stop()`,
+ * so setup doesn't count.
+ */
+static double timer_started;
+static unsigned long timer_allocs; // allocations at the start
+static unsigned long timed_allocs; // allocations while timing, in total
+
+static void timer_start(void) {
+    timer_allocs = allocs;
+    timer_started = now();
+}
+
+/** Return: seconds since `timer_start()` */
+static double timer_stop(void) {
+    double time = now() - timer_started;
+    timed_allocs += allocs - timer_allocs;
+    return time;
+}
+
+/** What a benchmark works on */
+struct bench_size {
+    unsigned dims;
+    unsigned long dims_array[3];
+    unsigned long cells;
+};
+
+/** Where a benchmark puts and finds its files */
+struct bench_env {
+    const char* dir;
+    const char* bin_dir;
+};
+
+/**
+ * A benchmark
+ *
+ * `setup` runs once before the runs, untimed, and may be NULL. `run` does one
+ * run, and returns the seconds its timed part took, or a negative number on
+ * failure. If `peak_rss` is set to something other than -1, it's used in place
+ * of the child's own, for benchmarks that run other programs.
+ */
+struct bench {
+    const char* name;
+    unsigned dims;   // 2 or 3
+    int linked;      // uses `struct cell`s, so only run on small sizes
+    void (*setup)(const struct bench_size* size, const struct bench_env* env);
+    double (*run)(const struct bench_size* size, const struct bench_env* env, long* peak_rss);
+};
+
+static struct rng bench_rng(void) {
+    struct rng rng;
+    rng_seed(&rng, SEED);
+    return rng;
+}
+
+static void scratch_path(char* path, const struct bench_env* env, const struct bench_size* size, const char* ext) {
+    sprintf(path, "%s/%lux%lu.%s", env->dir, size->dims_array[0], size->dims_array[1], ext);
+}
+
+static double run_alloc_maze(const struct bench_size* size, const struct bench_env* env, long* peak_rss) {
+    unsigned long dims_array[3];
+    memcpy(dims_array, size->dims_array, sizeof(dims_array));
+    timer_start();
+    struct maze* maze = alloc_maze(size->dims, dims_array);
+    double time = timer_stop();
+    clean_maze(maze);
+    return time;
+}
+
+static double run_link_neighs(const struct bench_size* size, const struct bench_env* env, long* peak_rss) {
+    unsigned long dims_array[3];
+    memcpy(dims_array, size->dims_array, sizeof(dims_array));
+    struct rng rng = bench_rng();
+    struct maze* maze = alloc_maze(size->dims, dims_array);
+    timer_start();
+    link_neighs(maze, &rng);
+    double time = timer_stop();
+    clean_maze(maze);
+    return time;
+}
+
+static double run_gen_maze(const struct bench_size* size, const struct bench_env* env, long* peak_rss) {
+    unsigned long dims_array[3];
+    memcpy(dims_array, size->dims_array, sizeof(dims_array));
+    struct rng rng = bench_rng();
+    struct maze* maze = alloc_maze(size->dims, dims_array);
+    link_neighs(maze, &rng);
+    timer_start();
+    gen_maze(&maze->cells[0], 0, maze, NULL, NULL);
+    double time = timer_stop();
+    clean_maze(maze);
+    return time;
+}
+
+static double run_gen_maze_4(const struct bench_size* size, const struct bench_env* env, long* peak_rss) {
+    struct rng rng = bench_rng();
+    timer_start();
+    struct maze* maze = gen_maze_4(size->dims_array[0], size->dims_array[1], 0, &rng, NULL, NULL);
+    double time = timer_stop();
+    clean_maze(maze);
+    return time;
+}
+
+static double run_gen_maze_3d_6(const struct bench_size* size, const struct bench_env* env, long* peak_rss) {
+    struct rng rng = bench_rng();
+    timer_start();
+    struct maze* maze = gen_maze_3d_6(size->dims_array[0], size->dims_array[1], size->dims_array[2], 0, &rng, NULL, NULL);
+    double time = timer_stop();
+    clean_maze(maze);
+    return time;
+}
+
+// Time writing a freshly generated maze to a file in the scratch directory
+static double time_write(const struct bench_size* size, const struct bench_env* env, const char* format, const char* ext) {
+    struct rng rng = bench_rng();
+    struct maze* maze = gen_maze_4(size->dims_array[0], size->dims_array[1], 0, &rng, NULL, NULL);
+    char path[4096];
+    scratch_path(path, env, size, ext);
+
+    timer_start();
+    FILE* file = fopen(path, "wb");
+    int err = !file || write_maze(file, maze, format, SEED, MAZEFILE_ALGORITHM_DFS);
+    if (file) err = fclose(file) || err;
+    double time = timer_stop();
+
+    clean_maze(maze);
+    return err ? -1 : time;
+}
+
+static double run_write_maze_png(const struct bench_size* size, const struct bench_env* env, long* peak_rss) {
+    return time_write(size, env, "png", "png");
+}
+
+static double run_write_maze_text(const struct bench_size* size, const struct bench_env* env, long* peak_rss) {
+    return time_write(size, env, "text", "txt");
+}
+
+// The converters need something to convert
+static void setup_converters(const struct bench_size* size, const struct bench_env* env) {
+    time_write(size, env, "png", "png");
+    time_write(size, env, "text", "txt");
+}
+
+// Time running one of the converter programs, recording its peak RSS
+static double time_program(const struct bench_env* env, const char* program, const char* in, const char* out, long* peak_rss) {
+    char exec_path[4096];
+    sprintf(exec_path, "%s/%s", env->bin_dir, program);
+
+    timer_start();
+    pid_t pid = fork();
+    if (pid == 0) {
+        char* argv[] = {exec_path, (char*) in, (char*) out, NULL};
+        execv(exec_path, argv);
+        _exit(127);
+    }
+    int status;
+    struct rusage rusage;
+    if (pid < 0 || wait4(pid, &status, 0, &rusage) < 0) return -1;
+    double time = timer_stop();
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) return -1;
+    if (rusage.ru_maxrss > *peak_rss) *peak_rss = rusage.ru_maxrss;
+    return time;
+}
+
+static double run_txt_to_png(const struct bench_size* size, const struct bench_env* env, long* peak_rss) {
+    char in[4096], out[4096];
+    scratch_path(in, env, size, "txt");
+    scratch_path(out, env, size, "converted.png");
+    return time_program(env, "txt-to-png", in, out, peak_rss);
+}
+
+static double run_png_to_txt(const struct bench_size* size, const struct bench_env* env, long* peak_rss) {
+    char in[4096], out[4096];
+    scratch_path(in, env, size, "png");
+    scratch_path(out, env, size, "converted.txt");
+    return time_program(env, "png-to-txt", in, out, peak_rss);
+}
+
+static const struct bench benches[] = {
+    {"alloc_maze", 2, 1, NULL, run_alloc_maze},
+    {"link_neighs", 2, 1, NULL, run_link_neighs},
+    {"gen_maze", 2, 1, NULL, run_gen_maze},
+    {"gen_maze_4", 2, 0, NULL, run_gen_maze_4},
+    {"gen_maze_3d_6", 3, 0, NULL, run_gen_maze_3d_6},
+    {"write_maze_png", 2, 0, NULL, run_write_maze_png},
+    {"write_maze_text", 2, 0, NULL, run_write_maze_text},
+    {"txt-to-png", 2, 0, setup_converters, run_txt_to_png},
+    {"png-to-txt", 2, 0, setup_converters, run_png_to_txt},
+};
+
+/** What a child reports back about its runs */
+struct child_report {
+    unsigned runs;
+    double times[MAX_RUNS];
+    unsigned long allocs;  // per run
+    long peak_rss;         // KiB, or -1 to use the child's own
+};
+
+/** The result of one benchmark at one size */
+struct result {
+    const char* name;
+    char size[64];
+    unsigned long cells;
+    unsigned runs;
+    double min, p10, median, p90, max;
+    long peak_rss;
+    long allocs;           // per run, or -1 if not counted
+};
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*) a, y = *(const double*) b;
+    return (x > y) - (x < y);
+}
+
+// Nearest rank percentile of sorted times
+static double percentile(const double* sorted, unsigned n, double p) {
+    unsigned rank = (unsigned) ceil(p * n);
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+/**
+ * Run a benchmark in a child process
+ * The child does at least `runs` runs, and more while they've taken less than
+ * `budget` seconds, up to `max_runs`.
+ *
+ * Return: 0 on success, with `report` and the child's `rusage` filled in
+ */
+static int run_child(const struct bench* bench, const struct bench_size* size, const struct bench_env* env, int setup,
+        unsigned runs, unsigned max_runs, double budget, struct child_report* report, struct rusage* rusage) {
+    int fds[2];
+    if (pipe(fds)) return 1;
+
+    pid_t pid = fork();
+    if (pid < 0) return 1;
+    if (pid == 0) {
+        close(fds[0]);
+        struct child_report child = { 0, {0}, 0, -1 };
+        if (setup && bench->setup) bench->setup(size, env);
+        double spent = 0;
+        for (child.runs = 0; child.runs < runs || (spent < budget && child.runs < max_runs); child.runs++) {
+            double time = bench->run(size, env, &child.peak_rss);
+            if (time < 0) _exit(1);
+            child.times[child.runs] = time;
+            spent += time;
+        }
+        child.allocs = timed_allocs / child.runs;
+        _exit(write(fds[1], &child, sizeof(child)) != sizeof(child));
+    }
+
+    close(fds[1]);
+    ssize_t got = read(fds[0], report, sizeof(*report));
+    close(fds[0]);
+    int status;
+    if (wait4(pid, &status, 0, rusage) < 0) return 1;
+    return got != sizeof(*report) || !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+}
+
+/**
+ * Run a benchmark and fill in its result
+ *
+ * The runs are split between BENCH_PROCESSES children, since how fast a
+ * process runs depends on where its memory landed as well as on the code, and
+ * the percentiles should show that.
+ */
+static int run_bench(const struct bench* bench, const struct bench_size* size, const struct bench_env* env, unsigned runs, struct result* result) {
+    unsigned processes = runs < BENCH_PROCESSES ? runs : BENCH_PROCESSES;
+    struct child_report report = { 0, {0}, 0, -1 };
+    long peak_rss = 0;
+    for (unsigned i = 0; i < processes; i++) {
+        // Later children reuse the first one's setup
+        struct child_report child;
+        struct rusage rusage;
+        unsigned child_runs = runs / processes + (i < runs % processes);
+        if (run_child(bench, size, env, i == 0, child_runs, MAX_RUNS / processes,
+                MIN_BENCH_SECONDS / processes, &child, &rusage)) {
+            return 1;
+        }
+        memcpy(&report.times[report.runs], child.times, child.runs * sizeof(double));
+        report.runs += child.runs;
+        report.allocs = child.allocs;
+        if (child.peak_rss > report.peak_rss) report.peak_rss = child.peak_rss;
+        if (rusage.ru_maxrss > peak_rss) peak_rss = rusage.ru_maxrss;
+    }
+
+    qsort(report.times, report.runs, sizeof(double), compare_doubles);
+    result->name = bench->name;
+    if (size->dims == 3) {
+        sprintf(result->size, "%lux%lux%lu", size->dims_array[0], size->dims_array[1], size->dims_array[2]);
+    } else {
+        sprintf(result->size, "%lux%lu", size->dims_array[0], size->dims_array[1]);
+    }
+    result->cells = size->cells;
+    result->runs = report.runs;
+    result->min = report.times[0];
+    result->p10 = percentile(report.times, report.runs, 0.1);
+    result->median = percentile(report.times, report.runs, 0.5);
+    result->p90 = percentile(report.times, report.runs, 0.9);
+    result->max = report.times[report.runs - 1];
+    // Other programs allocate outside of our counting
+    result->peak_rss = report.peak_rss >= 0 ? report.peak_rss : peak_rss;
+    result->allocs = report.peak_rss >= 0 ? -1 : (long) report.allocs;
+    return 0;
+}
+
+static void write_result(FILE* out, const struct result* r, int last) {
+    fprintf(out, "    {\"name\": \"%s\", \"size\": \"%s\", \"cells\": %lu, \"runs\": %u, "
+            "\"min_s\": %.6f, \"p10_s\": %.6f, \"median_s\": %.6f, \"p90_s\": %.6f, \"max_s\": %.6f, "
+            "\"cells_per_s\": %.0f, \"peak_rss_kb\": %ld, ",
+            r->name, r->size, r->cells, r->runs, r->min, r->p10, r->median, r->p90, r->max,
+            r->median > 0 ? (double) r->cells / r->median : 0.0, r->peak_rss);
+    if (r->allocs >= 0) {
+        fprintf(out, "\"allocs\": %ld}", r->allocs);
+    } else {
+        fprintf(out, "\"allocs\": null}");
+    }
+    fprintf(out, "%s\n", last ? "" : ",");
+}
+
+// Pull a number field out of one of our result lines
+static int read_number_field(const char* line, const char* field, double* out) {
+    char pattern[64];
+    sprintf(pattern, "\"%s\": ", field);
+    const char* start = strstr(line, pattern);
+    if (!start) return 1;
+    *out = strtod(start + strlen(pattern), NULL);
+    return 0;
+}
+
+// Pull a string field out of one of our result lines
+static int read_string_field(const char* line, const char* field, char* out, size_t len) {
+    char pattern[64];
+    sprintf(pattern, "\"%s\": \"", field);
+    const char* start = strstr(line, pattern);
+    if (!start) return 1;
+    start += strlen(pattern);
+    const char* end = strchr(start, '"');
+    if (!end || (size_t)(end - start) >= len) return 1;
+    memcpy(out, start, (size_t)(end - start));
+    out[end - start] = '\0';
+    return 0;
+}
+
+/**
+ * Compare results against a baseline written by a previous run
+ * Only understands the output of `write_result()`, one result per line.
+ *
+ * Rather than comparing medians, which move with noise, a regression's p10
+ * has to be more than `threshold` percent slower than the baseline's p90, and
+ * an improvement's p90 that much faster than its p10. The change shown is
+ * still the medians'.
+ *
+ * Return: the number of regressions, or -1 if the baseline couldn't be read
+ */
+static int compare_baseline(const char* path, const struct result* results, size_t count, double threshold) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Error: couldn't read baseline `%s`\n", path);
+        return -1;
+    }
+
+    int regressions = 0;
+    char line[1024];
+    while (fgets(line, sizeof(line), file)) {
+        char name[64], size[64];
+        if (read_string_field(line, "name", name, sizeof(name))) continue;
+        if (read_string_field(line, "size", size, sizeof(size))) continue;
+        double baseline, baseline_p10, baseline_p90;
+        if (read_number_field(line, "median_s", &baseline)) continue;
+        if (read_number_field(line, "p10_s", &baseline_p10)) continue;
+        if (read_number_field(line, "p90_s", &baseline_p90)) continue;
+
+        for (size_t i = 0; i < count; i++) {
+            const struct result* result = &results[i];
+            if (strcmp(result->name, name) != 0 || strcmp(result->size, size) != 0) continue;
+            double change = baseline > 0 ? (result->median / baseline - 1) * 100 : 0;
+            const char* verdict = "";
+            if (baseline < MIN_COMPARE_SECONDS && result->median < MIN_COMPARE_SECONDS) {
+                verdict = "  too fast to compare";
+            } else if (result->p10 > baseline_p90 * (1 + threshold / 100)) {
+                verdict = "  REGRESSION";
+                regressions++;
+            } else if (result->p90 < baseline_p10 * (1 - threshold / 100)) {
+                verdict = "  improved";
+            }
+            fprintf(stderr, "%-16s %-16s %10.6fs -> %10.6fs %+7.1f%%%s\n",
+                    name, size, baseline, result->median, change, verdict);
+        }
+    }
+    fclose(file);
+    return regressions;
+}
+
+// Parse a comma separated list of sizes
+static size_t parse_sizes(const char* str, unsigned long* sizes, size_t max) {
+    size_t count = 0;
+    char* endptr;
+    while (*str && count < max) {
+        sizes[count] = strtoul(str, &endptr, 10);
+        if (sizes[count] < 1 || (*endptr != ',' && *endptr != '\0')) return 0;
+        count++;
+        str = *endptr ? endptr + 1 : endptr;
+    }
+    return count;
+}
+
+int main(int argc, char** argv) {
+    const char* sizes_str = DEFAULT_SIZES;
+    unsigned long runs = DEFAULT_RUNS;
+    const char* out_path = NULL;
+    const char* baseline = NULL;
+    double threshold = DEFAULT_THRESHOLD;
+    struct bench_env env = { DEFAULT_DIR, "." };
+
+    for (int i = 1; i < argc; i++) {
+        if (i == argc - 1) {
+            fprintf(stderr, USAGE, argv[0]);
+            return 2;
+        } else if (strcmp(argv[i], "--sizes") == 0) {
+            sizes_str = argv[++i];
+        } else if (strcmp(argv[i], "--runs") == 0) {
+            runs = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--out") == 0) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "--baseline") == 0) {
+            baseline = argv[++i];
+        } else if (strcmp(argv[i], "--threshold") == 0) {
+            threshold = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--dir") == 0) {
+            env.dir = argv[++i];
+        } else {
+            fprintf(stderr, USAGE, argv[0]);
+            return 2;
+        }
+    }
+    if (runs < 1 || runs > MAX_RUNS) {
+        fprintf(stderr, "Error: --runs must be between 1 and %d\n", MAX_RUNS);
+        return 2;
+    }
+    unsigned long sides[32];
+    size_t num_sides = parse_sizes(sizes_str, sides, 32);
+    if (!num_sides) {
+        fprintf(stderr, "Error: `%s` isn't a list of sizes\n", sizes_str);
+        return 2;
+    }
+
+    // The converters live next to the bench
+    char* bin_dir = strdup(argv[0]);
+    char* slash = strrchr(bin_dir, '/');
+    if (slash) {
+        *slash = '\0';
+        env.bin_dir = bin_dir;
+    }
+    mkdir(env.dir, 0777);
+
+    size_t max_results = num_sides * sizeof(benches) / sizeof(benches[0]);
+    struct result* results = malloc(max_results * sizeof(struct result));
+    size_t count = 0;
+    int failures = 0;
+    for (size_t s = 0; s < num_sides; s++) {
+        for (size_t b = 0; b < sizeof(benches) / sizeof(benches[0]); b++) {
+            const struct bench* bench = &benches[b];
+            // Sizes are n by n, and 3d mazes get about as many cells
+            struct bench_size size = { bench->dims, {sides[s], sides[s], 1}, 0 };
+            if (bench->dims == 3) {
+                unsigned long side = (unsigned long) lround(cbrt((double) sides[s] * (double) sides[s]));
+                if (side < 1) side = 1;
+                size.dims_array[0] = size.dims_array[1] = size.dims_array[2] = side;
+            }
+            size.cells = size.dims_array[0] * size.dims_array[1] * (bench->dims == 3 ? size.dims_array[2] : 1);
+            if (bench->linked && size.cells > LINKED_MAX_CELLS) continue;
+
+            unsigned bench_runs = (unsigned) runs;
+            if (size.cells > BIG_CELLS && bench_runs > BIG_RUNS) bench_runs = BIG_RUNS;
+
+            fprintf(stderr, "%s %lu cells...\n", bench->name, size.cells);
+            if (run_bench(bench, &size, &env, bench_runs, &results[count])) {
+                fprintf(stderr, "Error: %s failed at %lu cells\n", bench->name, size.cells);
+                failures++;
+                continue;
+            }
+            count++;
+        }
+    }
+
+    FILE* out = out_path ? fopen(out_path, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "Error: couldn't open `%s` for writing\n", out_path);
+        return 1;
+    }
+    fprintf(out, "{\n  \"version\": \"%s\",\n  \"results\": [\n", MAZE_VERSION);
+    for (size_t i = 0; i < count; i++) write_result(out, &results[i], i + 1 == count);
+    fprintf(out, "  ]\n}\n");
+    if (out != stdout) fclose(out);
+
+    int regressions = 0;
+    if (baseline) regressions = compare_baseline(baseline, results, count, threshold);
+
+    free(results);
+    free(bin_dir);
+    if (regressions < 0) return 1;
+    if (failures > 0) {
+        fprintf(stderr, "%d benchmark%s failed\n", failures, failures == 1 ? "" : "s");
+        return 1;
+    }
+    if (regressions > 0) {
+        fprintf(stderr, "%d regression%s past %.0f%%\n", regressions, regressions == 1 ? "" : "s", threshold);
+        return 1;
+    }
+    return 0;
+}
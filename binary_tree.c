@@ -0,0 +1,53 @@
+#include "binary_tree.h"
+#include "raster.h"
+#include "stats.h"
+#include <stdlib.h> // malloc(), free()
+
+struct binary_tree {
+    unsigned long rows;
+    unsigned long cols;
+    unsigned long row; // how many rows have been generated
+    struct rng* rng;
+};
+
+struct binary_tree* new_binary_tree(unsigned long rows, unsigned long cols, struct rng* rng) {
+    struct binary_tree* tree = stats_malloc(sizeof(struct binary_tree));
+    tree->rows = rows;
+    tree->cols = cols;
+    tree->row = 0;
+    tree->rng = rng;
+    return tree;
+}
+
+int binary_tree_next_row(void* ctx, unsigned char* row) {
+    struct binary_tree* tree = ctx;
+    if (tree->row >= tree->rows) return 1;
+    STATS_PHASE_START(timer);
+    unsigned long cols = tree->cols;
+    int last = tree->row + 1 == tree->rows;
+
+    // A random bit per cell, drawn 64 at a time
+    uint64_t bits = 0;
+    for (unsigned long c = 0; c < cols; c++) {
+        if (c % 64 == 0) bits = rng_next(tree->rng);
+        if (last) {
+            row[c] = ROW_VISITED | ROW_EAST;
+        } else if (c + 1 == cols) {
+            row[c] = ROW_VISITED | ROW_SOUTH;
+        } else {
+            row[c] = ROW_VISITED | ((bits & 1) ? ROW_SOUTH : ROW_EAST);
+        }
+        bits >>= 1;
+    }
+    // The bottom right corner is the root of the tree
+    if (last) row[cols - 1] = ROW_VISITED;
+
+    tree->row++;
+    STATS_SEARCH(0, cols);
+    STATS_PHASE_END(MAZE_PHASE_CARVE, timer);
+    return 0;
+}
+
+void binary_tree_deallocate(struct binary_tree* tree) {
+    stats_free(tree);
+}
@@ -0,0 +1,36 @@
+#ifndef MAZE_GEN_BINARY_TREE_H
+#define MAZE_GEN_BINARY_TREE_H
+
+#include "rng.h"
+
+/**
+ * Generates a two dimensional maze a row at a time, with the binary tree
+ * algorithm
+ *
+ * Every cell opens a passage either south or east, picked at random, except
+ * along the bottom row and right hand column where there's only one choice.
+ * Each row is independent of the others, so nothing but the position is
+ * kept between rows. The mazes are strongly biased, with unbroken corridors
+ * along the bottom and right.
+ */
+typedef struct binary_tree* binary_tree_t;
+
+/**
+ * Instantiate a new generator for a `rows` by `cols` maze
+ * rng is the source of randomness, and must outlive the generator.
+ */
+binary_tree_t new_binary_tree(unsigned long rows, unsigned long cols, struct rng* rng);
+
+/**
+ * Generate the next row, like `eller_next_row()`
+ *
+ * Return: 0 on success, nonzero if every row has already been generated
+ */
+int binary_tree_next_row(void* binary_tree, unsigned char* row);
+
+/**
+ * Free the generator
+ */
+void binary_tree_deallocate(binary_tree_t binary_tree);
+
+#endif
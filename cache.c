@@ -0,0 +1,275 @@
+#define _POSIX_C_SOURCE 200809L // utimensat(), mkdir()
+
+#include "cache.h"
+#include "algorithms.h"
+#include "maze_writer.h"
+#include "rng.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>    // AT_FDCWD
+#include <inttypes.h> // PRIu64, PRIx64
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h> // malloc(), realloc(), free(), qsort()
+#include <string.h> // strlen(), strcpy()
+#include <sys/stat.h>
+#include <time.h>   // time()
+#include <unistd.h> // getpid(), unlink()
+
+// The build, set by the Makefile. Keys include it so a new build never
+// serves mazes from an old one.
+#ifndef MAZE_VERSION
+#define MAZE_VERSION "unknown"
+#endif
+
+// Cache files are named by their key, as 16 hex digits
+#define NAME_LEN 16
+
+// When evicting, go this far under the limit so eviction doesn't run on
+// every store
+#define EVICT_TO(max_bytes) ((max_bytes) / 4 * 3)
+
+// Files are written under this prefix, then renamed into place
+#define TMP_PREFIX ".tmp-"
+
+// A temporary file this old was left by a writer that crashed
+#define STALE_TMP_SECONDS 600
+
+// Other processes' stores are only seen by totalling up the directory, which
+// is done at least this often
+#define RESCAN_SECONDS 60
+
+struct maze_cache {
+    char* dir;
+    uint64_t max_bytes;
+    pthread_mutex_t lock; // protects everything below
+    unsigned long tmp_id; // makes temporary names unique within the process
+    uint64_t bytes;       // the size of the directory at the last scan, plus our stores since
+    time_t scanned;       // when the last scan was
+};
+
+// Build the path of a file in the cache. `path` must fit the directory and
+// a name.
+static void cache_path(const struct maze_cache* cache, const char* name, char* path) {
+    sprintf(path, "%s/%s", cache->dir, name);
+}
+
+static size_t path_size(const struct maze_cache* cache) {
+    return strlen(cache->dir) + 1 + NAME_LEN + 64;
+}
+
+static int is_cache_name(const char* name) {
+    if (strlen(name) != NAME_LEN) return 0;
+    for (const char* c = name; *c; c++) {
+        if (!((*c >= '0' && *c <= '9') || (*c >= 'a' && *c <= 'f'))) return 0;
+    }
+    return 1;
+}
+
+/** A file in the cache, for eviction */
+struct entry {
+    struct timespec used;
+    uint64_t size;
+    char name[NAME_LEN + 1];
+};
+
+static int compare_used(const void* a, const void* b) {
+    const struct timespec* x = &((const struct entry*) a)->used;
+    const struct timespec* y = &((const struct entry*) b)->used;
+    if (x->tv_sec != y->tv_sec) return x->tv_sec < y->tv_sec ? -1 : 1;
+    if (x->tv_nsec != y->tv_nsec) return x->tv_nsec < y->tv_nsec ? -1 : 1;
+    return 0;
+}
+
+/**
+ * Total up the directory, and if it's over the limit, remove the least
+ * recently used files until it's well under
+ * Every process sharing the directory adds to it, so only the directory
+ * itself knows how big it is. Temporary files count while they're being
+ * written, and are removed once they're stale.
+ * Sets `bytes` to what's left and `scanned` to now. Must hold the lock.
+ */
+static void scan(struct maze_cache* cache) {
+    DIR* dir = opendir(cache->dir);
+    if (!dir) return;
+    time_t now = time(NULL);
+
+    char* path = malloc(path_size(cache));
+    size_t count = 0, cap = 64;
+    struct entry* entries = malloc(cap * sizeof(struct entry));
+    uint64_t total = 0;
+
+    struct dirent* ent;
+    while ((ent = readdir(dir))) {
+        // Only our own temporary names, which fit in `path`
+        int tmp = strncmp(ent->d_name, TMP_PREFIX, strlen(TMP_PREFIX)) == 0 && strlen(ent->d_name) <= NAME_LEN + 32;
+        if (!tmp && !is_cache_name(ent->d_name)) continue;
+        cache_path(cache, ent->d_name, path);
+        struct stat st;
+        if (stat(path, &st)) continue;
+        if (tmp) {
+            if (now - st.st_mtime < STALE_TMP_SECONDS) {
+                total += (uint64_t) st.st_size;
+            } else {
+                unlink(path);
+            }
+            continue;
+        }
+        if (count == cap) {
+            cap *= 2;
+            entries = realloc(entries, cap * sizeof(struct entry));
+        }
+        entries[count].used = st.st_mtim;
+        entries[count].size = (uint64_t) st.st_size;
+        strcpy(entries[count].name, ent->d_name);
+        count++;
+        total += (uint64_t) st.st_size;
+    }
+    closedir(dir);
+
+    if (total > cache->max_bytes) {
+        uint64_t target = EVICT_TO(cache->max_bytes);
+        qsort(entries, count, sizeof(struct entry), compare_used);
+        for (size_t i = 0; i < count && total > target; i++) {
+            cache_path(cache, entries[i].name, path);
+            // Another process may have beaten us to it, that's fine
+            if (unlink(path) == 0 || errno == ENOENT) total -= entries[i].size;
+        }
+    }
+    cache->bytes = total;
+    cache->scanned = now;
+
+    free(entries);
+    free(path);
+}
+
+maze_cache_t new_maze_cache(const char* dir, uint64_t max_bytes) {
+    if (mkdir(dir, 0777) && errno != EEXIST) return NULL;
+    DIR* d = opendir(dir);
+    if (!d) return NULL;
+    closedir(d);
+
+    struct maze_cache* cache = malloc(sizeof(struct maze_cache));
+    cache->dir = malloc(strlen(dir) + 1);
+    strcpy(cache->dir, dir);
+    cache->max_bytes = max_bytes;
+    cache->tmp_id = 0;
+    cache->bytes = 0;
+    cache->scanned = 0;
+    pthread_mutex_init(&cache->lock, NULL);
+
+    pthread_mutex_lock(&cache->lock);
+    scan(cache);
+    pthread_mutex_unlock(&cache->lock);
+    return cache;
+}
+
+uint64_t maze_cache_key(const char* generator, unsigned long rows, unsigned long cols,
+        unsigned long limit, uint64_t seed, const char* format) {
+    char params[128];
+    snprintf(params, sizeof(params), "%lu %lu %lu %" PRIu64, rows, cols, limit, seed);
+
+    // FNV-1a over each part, with a separator so parts can't run together
+    const char* parts[] = {MAZE_VERSION, generator, params, format};
+    uint64_t hash = 0xcbf29ce484222325u;
+    for (size_t i = 0; i < sizeof(parts) / sizeof(parts[0]); i++) {
+        for (const char* c = parts[i]; ; c++) {
+            hash ^= (unsigned char) *c;
+            hash *= 0x100000001b3u;
+            if (!*c) break;
+        }
+    }
+    return hash;
+}
+
+int maze_cache_get(maze_cache_t cache, uint64_t key, char** out, size_t* len) {
+    char name[NAME_LEN + 1];
+    sprintf(name, "%016" PRIx64, key);
+    char* path = malloc(path_size(cache));
+    cache_path(cache, name, path);
+
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        free(path);
+        return 1;
+    }
+
+    int err = 1;
+    struct stat st;
+    if (fstat(fileno(file), &st) == 0) {
+        size_t size = (size_t) st.st_size;
+        char* data = malloc(size ? size : 1);
+        if (fread(data, 1, size, file) == size) {
+            *out = data;
+            *len = size;
+            err = 0;
+        } else {
+            free(data);
+        }
+    }
+    fclose(file);
+
+    // Mark it as recently used
+    if (!err) utimensat(AT_FDCWD, path, NULL, 0);
+    free(path);
+    return err;
+}
+
+void maze_cache_put(maze_cache_t cache, uint64_t key, const char* data, size_t len) {
+    char name[NAME_LEN + 1];
+    sprintf(name, "%016" PRIx64, key);
+    char* path = malloc(path_size(cache));
+    char* tmp = malloc(path_size(cache));
+    cache_path(cache, name, path);
+
+    pthread_mutex_lock(&cache->lock);
+    unsigned long id = cache->tmp_id++;
+    pthread_mutex_unlock(&cache->lock);
+    sprintf(tmp, "%s/" TMP_PREFIX "%ld-%lu", cache->dir, (long) getpid(), id);
+
+    FILE* file = fopen(tmp, "wb");
+    int err = !file;
+    if (file) {
+        err = fwrite(data, 1, len, file) != len;
+        err = fclose(file) || err;
+    }
+    // Renaming is atomic, so nobody reads a partial file
+    if (err || rename(tmp, path)) {
+        unlink(tmp);
+    } else {
+        // Only this process's stores are counted between scans, so scan when
+        // those alone fill the cache, or when the others' may have
+        pthread_mutex_lock(&cache->lock);
+        cache->bytes += len;
+        if (cache->bytes > cache->max_bytes || time(NULL) - cache->scanned >= RESCAN_SECONDS) scan(cache);
+        pthread_mutex_unlock(&cache->lock);
+    }
+
+    free(tmp);
+    free(path);
+}
+
+void maze_cache_deallocate(maze_cache_t cache) {
+    pthread_mutex_destroy(&cache->lock);
+    free(cache->dir);
+    free(cache);
+}
+
+int cached_maze(maze_cache_t cache, const struct maze_algorithm* algorithm, unsigned long rows, unsigned long cols,
+        unsigned long limit, const char* seed_str, const char* format, char** out, size_t* len) {
+    uint64_t seed = seed_str ? rng_hash_string(seed_str) : (uint64_t) time(0);
+    if (!seed_str) cache = NULL;
+    uint64_t key = cache ? maze_cache_key(algorithm->name, rows, cols, limit, seed, format) : 0;
+    if (cache && maze_cache_get(cache, key, out, len) == 0) return 0;
+
+    struct rng rng;
+    rng_seed(&rng, seed);
+    unsigned long dims_array[] = { rows, cols };
+    struct maze* maze = gen_maze_with(algorithm, 2, dims_array, limit, &rng, NULL, NULL);
+    if (!maze) return MAZE_CACHED_ERR_MEMORY;
+    int err = encode_maze(maze, format, seed, algorithm->id, out, len);
+    clean_maze(maze);
+    if (err) return MAZE_CACHED_ERR_ENCODE;
+    if (cache) maze_cache_put(cache, key, *out, *len);
+    return 0;
+}
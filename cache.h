@@ -0,0 +1,100 @@
+#ifndef MAZE_GEN_CACHE_H
+#define MAZE_GEN_CACHE_H
+
+#include <stdint.h> // uint64_t
+#include <stdlib.h> // size_t
+
+/**
+ * A bounded on-disk cache of encoded mazes
+ *
+ * A seeded maze only depends on its parameters and the code that generated
+ * it, so encoded mazes are stored in a directory under a hash of both, one
+ * file each. When the directory grows past its limit, the least recently used
+ * files are removed.
+ *
+ * Several processes can share a directory: files are written under a
+ * temporary name and renamed into place, so readers never see part of one.
+ * The directory is totalled up when a process's own stores would fill it,
+ * and every minute, so together they keep it near the limit. A cache can be
+ * shared by threads.
+ */
+typedef struct maze_cache* maze_cache_t;
+
+/** Size limit used if none is given, in bytes */
+#define MAZE_CACHE_DEFAULT_SIZE (256ul << 20)
+
+/**
+ * Open the cache in `dir`, creating the directory if needed
+ * Files past `max_bytes` are evicted as new ones are stored.
+ *
+ * Return: The cache, or NULL if the directory couldn't be used. Free with
+ *   `maze_cache_deallocate()`
+ */
+maze_cache_t new_maze_cache(const char* dir, uint64_t max_bytes);
+
+/**
+ * Get the key for a maze
+ *
+ * Args:
+ * * generator: how the maze is generated, e.g. "dfs" or "tiled 256". Mazes
+ *   from different generators must have different names.
+ * * rows, cols, limit, seed: the generation parameters
+ * * format: the output format
+ *
+ * The build's version goes into the key too, so changes to the generator
+ * never serve stale mazes.
+ */
+uint64_t maze_cache_key(const char* generator, unsigned long rows, unsigned long cols,
+        unsigned long limit, uint64_t seed, const char* format);
+
+/**
+ * Look up a maze
+ *
+ * Args:
+ * * out: set to the cached bytes on a hit, which the caller must `free()`
+ * * len: set to the length of `out` on a hit
+ *
+ * Return: 0 on a hit, nonzero on a miss
+ */
+int maze_cache_get(maze_cache_t cache, uint64_t key, char** out, size_t* len);
+
+/**
+ * Store a maze. Failing to store is silently ignored, it's only a cache.
+ */
+void maze_cache_put(maze_cache_t cache, uint64_t key, const char* data, size_t len);
+
+/**
+ * Free the cache. The files are left for next time.
+ */
+void maze_cache_deallocate(maze_cache_t cache);
+
+struct maze_algorithm;
+
+/** The maze couldn't be allocated */
+#define MAZE_CACHED_ERR_MEMORY 1
+/** The maze couldn't be encoded */
+#define MAZE_CACHED_ERR_ENCODE 2
+
+/**
+ * Get a two dimensional maze encoded as `format`, from the cache or freshly
+ * generated
+ *
+ * Seeded mazes are looked up in `cache`, and stored to it when they have to
+ * be generated. Unseeded mazes are different every time, so aren't worth
+ * caching.
+ *
+ * Args:
+ * * cache: the cache to go through, or NULL
+ * * rows, cols: the size, which the caller should have checked isn't too big
+ *   with `maze_cell_count()`
+ * * seed_str: the seed, hashed like `maze --seed` does, or NULL to seed from
+ *   the time
+ * * out: set to the encoded maze, which the caller must `free()`
+ * * len: set to the length of `out`
+ *
+ * Return: 0 on success, or one of the `MAZE_CACHED_ERR_*` codes
+ */
+int cached_maze(maze_cache_t cache, const struct maze_algorithm* algorithm, unsigned long rows, unsigned long cols,
+        unsigned long limit, const char* seed_str, const char* format, char** out, size_t* len);
+
+#endif
@@ -16,5 +16,13 @@ PORT = os.environ.get('PORT', 5000)
 SECRET_KEY = os.environ.get('SESSION_KEY', default=''.join(secrets.token_hex(16)))
 
 DEFAULT_SIZE = os.environ.get('MAZE_DEFAULT_SIZE', 50)
-EXEC_PATH = str(Path(os.environ.get('MAZE_EXEC_PATH', './maze')).resolve())
-OUT_PATH = Path(os.environ.get('MAZE_OUT_PATH', './maze.out')).resolve()
+# How to generate mazes: 'server' talks to `maze --serve` on SOCKET_PATH,
+# 'extension' generates in process with the module from `make python`
+BACKEND = os.environ.get('MAZE_BACKEND', 'server')
+# Unix socket of the maze server, started with `maze --serve <socket>`
+SOCKET_PATH = str(Path(os.environ.get('MAZE_SOCKET_PATH', './maze.sock')).resolve())
+# Directory for the on-disk cache, with the extension backend. The server
+# backend caches with `maze --serve <socket> --cache-dir <dir>` instead.
+CACHE_DIR = os.environ.get('MAZE_CACHE_DIR', None)
+# Most bytes of seeded mazes to keep in memory, per process
+CACHE_MEMORY_BYTES = os.environ.get('MAZE_CACHE_MEMORY_BYTES', 64 << 20)
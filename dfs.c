@@ -1,14 +1,16 @@
 #include "generator.h"
-#include "stack.h"
-#include <stdlib.h> // malloc(), free(), rand()
+#include "stats.h"
+#include <limits.h> // ULONG_MAX
+#include <stdint.h> // SIZE_MAX
+#include <stdlib.h> // calloc(), free()
 
-static void shuffle(struct linked_list* list) {
+static void shuffle(struct linked_list* list, struct rng* rng) {
     // Make an array to make shuffling easier
     size_t size = 0;
     for (struct list_node* node = list->start; node != NULL; node = node->next) size++;
 
     if (size > 0) {
-        struct list_node** array = calloc(size, sizeof(struct list_node*));
+        struct list_node** array = stats_calloc(size, sizeof(struct list_node*));
         size_t i = 0;
         for (struct list_node* node = list->start; node != NULL; node = node->next) {
             array[i++] = node;
@@ -16,7 +18,7 @@ static void shuffle(struct linked_list* list) {
 
         // Shuffle
         for (i = 0; i < size - 1; i++) {
-            size_t j = i + (size_t)rand() / (RAND_MAX / (size - i) + 1);
+            size_t j = i + (size_t)rng_below(rng, size - i);
             struct list_node* tmp = array[j];
             array[j] = array[i];
             array[i] = tmp;
@@ -35,135 +37,309 @@ static void shuffle(struct linked_list* list) {
             array[i]->prev = array[i-1];
         }
 
-        free(array);
+        stats_free(array);
     }
 }
 
-// Recursively allocate a maze, with one recursion layer per dimension
-struct cell** alloc_dim(unsigned dims, unsigned long* dims_array) {
-    if (dims == 0) {
-        // Init a node
-        struct cell* new = calloc(1, sizeof(struct cell));
-        return (struct cell**) new;
-    } else {
-        struct cell** this = calloc(dims_array[0], sizeof(struct cell**));
-        for (unsigned long i = 0; i < dims_array[0]; i++) {
-            this[i] = (struct cell*)alloc_dim(dims - 1, dims_array + 1);
-        }
-        return this;
+// Allocate the parts of a maze shared by linked and grid mazes, or return
+// NULL if they can't be
+static struct maze* alloc_shape(unsigned dims, unsigned long* dims_array) {
+    struct maze* out = stats_malloc(sizeof(struct maze));
+    if (!out) return NULL;
+    out->dims = dims;
+    out->dims_array = stats_calloc(dims, sizeof(unsigned long));
+    out->strides = stats_calloc(dims, sizeof(unsigned long));
+    out->cells = NULL;
+    out->grid = NULL;
+    out->pool = NULL;
+    if (!out->dims_array || !out->strides) {
+        clean_maze(out);
+        return NULL;
     }
+    out->size = 1;
+    for (unsigned d = dims; d-- > 0;) {
+        out->dims_array[d] = dims_array[d];
+        out->strides[d] = out->size;
+        out->size *= dims_array[d];
+    }
+    return out;
 }
 
 // Alocate a maze
 struct maze* alloc_maze(unsigned dims, unsigned long* dims_array) {
-    struct maze* out = malloc(sizeof(struct maze));
-    out->dims = dims;
-    out->dims_array = calloc(dims, sizeof(unsigned long));
-    for (unsigned d = 0; d < dims; d++) out->dims_array[d] = dims_array[d];
-    out->maze = (struct cell***)alloc_dim(dims, dims_array);
+    unsigned long cells;
+    if (maze_cell_count(dims, dims_array, &cells) || cells > SIZE_MAX / sizeof(struct cell)) return NULL;
+    STATS_PHASE_START(timer);
+    struct maze* out = alloc_shape(dims, dims_array);
+    if (!out) return NULL;
+    out->cells = stats_calloc(out->size, sizeof(struct cell));
+    out->pool = new_pool(sizeof(struct list_node));
+    if (!out->cells || !out->pool) {
+        clean_maze(out);
+        return NULL;
+    }
+    for (unsigned long i = 0; i < out->size; i++) {
+        list_init(&out->cells[i].walls, out->pool);
+        list_init(&out->cells[i].paths, out->pool);
+    }
+    STATS_PHASE_END(MAZE_PHASE_ALLOC, timer);
+    return out;
+}
+
+// Allocate a grid maze
+int maze_cell_count(unsigned dims, const unsigned long* dims_array, unsigned long* cells) {
+    unsigned long count = 1;
+    for (unsigned d = 0; d < dims; d++) {
+        if (dims_array[d] && count > ULONG_MAX / dims_array[d]) return 1;
+        count *= dims_array[d];
+    }
+    *cells = count;
+    return 0;
+}
+
+struct maze* alloc_grid(unsigned dims, unsigned long* dims_array) {
+    unsigned long cells;
+    if (dims > GRID_MAX_DIMS || maze_cell_count(dims, dims_array, &cells) || cells > SIZE_MAX / sizeof(grid_cell_t)) {
+        return NULL;
+    }
+    STATS_PHASE_START(timer);
+    struct maze* out = alloc_shape(dims, dims_array);
+    if (!out) return NULL;
+    out->grid = stats_calloc(out->size, sizeof(grid_cell_t));
+    if (!out->grid) {
+        clean_maze(out);
+        return NULL;
+    }
+    STATS_PHASE_END(MAZE_PHASE_ALLOC, timer);
     return out;
 }
 
+// Get the row-major index of the cell located at `coords`
+unsigned long cell_index(const struct maze* maze, const unsigned long* coords) {
+    unsigned long index = 0;
+    for (unsigned d = 0; d < maze->dims; d++) {
+        index = index * maze->dims_array[d] + coords[d];
+    }
+    return index;
+}
+
+// Derive the coordinates of `cell` from its index
+void cell_coords(const struct maze* maze, const struct cell* cell, unsigned long* coords) {
+    unsigned long index = (unsigned long)(cell - maze->cells);
+    for (unsigned d = maze->dims; d-- > 0;) {
+        coords[d] = index % maze->dims_array[d];
+        index /= maze->dims_array[d];
+    }
+}
+
 // Get a cell that is located at `coords` from `maze`
 // Coords are used in the order of `maze->dims_array`
 struct cell* get_cell(struct maze* maze, unsigned long* coords) {
-    struct cell** current = (struct cell**) maze->maze;
-    for (unsigned d = 0; d < maze->dims; d++) {
-        current = (struct cell**)current[coords[d]];
+    return &maze->cells[cell_index(maze, coords)];
+}
+
+// Find the neighbor of the cell at `index` in direction `dir`
+int maze_neighbor(const struct maze* maze, unsigned long index, unsigned dir, unsigned long* neighbor) {
+    unsigned d = dir / 2;
+    unsigned long coord = (index / maze->strides[d]) % maze->dims_array[d];
+    if (dir == DIR_PLUS(d)) {
+        if (coord + 1 >= maze->dims_array[d]) return 0;
+        *neighbor = index + maze->strides[d];
+    } else {
+        if (coord == 0) return 0;
+        *neighbor = index - maze->strides[d];
     }
-    return (struct cell*) current;
+    return 1;
+}
+
+// Check for a passage from the cell at `index` in direction `dir`
+int maze_passage(const struct maze* maze, unsigned long index, unsigned dir) {
+    if (maze->grid) return (maze->grid[index] & GRID_PASSAGE(dir)) != 0;
+
+    unsigned long other;
+    if (!maze_neighbor(maze, index, dir, &other)) return 0;
+
+    // Paths only go one way, from the cell that was carved from
+    const struct cell* cell = &maze->cells[index];
+    const struct cell* neigh = &maze->cells[other];
+    for (struct list_node* path = cell->paths.start; path != NULL; path = path->next) {
+        if (path->cell == neigh) return 1;
+    }
+    for (struct list_node* path = neigh->paths.start; path != NULL; path = path->next) {
+        if (path->cell == cell) return 1;
+    }
+    return 0;
+}
+
+// Check whether generation has reached the cell at `index`
+int maze_visited(const struct maze* maze, unsigned long index) {
+    if (maze->grid) return (maze->grid[index] & GRID_VISITED) != 0;
+    return maze->cells[index].visited;
 }
 
 // Link each cell in the maze to its neighbors
 //
 // Neighbors are defined by:
 // Any two cells who's coordinates differ by exactly 1 in exactly 1 dimension are neighbors.
-void link_neighs(struct maze* maze) {
-    unsigned long* coords = calloc(maze->dims, sizeof(unsigned long));
-    struct cell* cell;
-    struct cell* other;
-    while (1) {
-        cell = get_cell(maze, coords);
-
-        // Set coords
-        cell->coords = calloc(maze->dims, sizeof(unsigned long));
-        for (unsigned c = 0; c < maze->dims; c++) cell->coords[c] = coords[c];
+void link_neighs(struct maze* maze, struct rng* rng) {
+    STATS_PHASE_START(timer);
+    unsigned long* strides = maze->strides;
+    unsigned long* coords = stats_calloc(maze->dims, sizeof(unsigned long));
+    for (unsigned long i = 0; i < maze->size; i++) {
+        struct cell* cell = &maze->cells[i];
 
         // Link neighbors
         for (unsigned d = 0; d < maze->dims; d++) {
             if (coords[d] + 1 < maze->dims_array[d]) {
                 // plus 1
-                coords[d]++;
-                other = get_cell(maze, coords);
-                list_push(&cell->walls, other);
-                coords[d]--;
+                list_push(&cell->walls, cell + strides[d]);
             }
-            if (coords[d] - 1 < maze->dims_array[d]) {
-                // minus 1 (unsigned, so we're checking for underflow)
-                coords[d]--;
-                other = get_cell(maze, coords);
-                list_push(&cell->walls, other);
-                coords[d]++;
+            if (coords[d] > 0) {
+                // minus 1
+                list_push(&cell->walls, cell - strides[d]);
             }
         }
 
-        shuffle(&cell->walls);
+        shuffle(&cell->walls, rng);
 
-        // Increment the coordinate
-        // Yes this is painful, but it handles n dimensions
-        coords[maze->dims - 1]++;
-        int overflow = coords[maze->dims - 1] >= maze->dims_array[maze->dims - 1];
-        for (long d = maze->dims - 2; d >= 0 && overflow; d--) {
-            coords[d + 1] =  0;
-            coords[d]++;
-            overflow = coords[d] >= maze->dims_array[d];
+        // Increment the coordinate to match the next index
+        for (unsigned d = maze->dims; d-- > 0;) {
+            if (++coords[d] < maze->dims_array[d]) break;
+            coords[d] = 0;
         }
-        if (overflow) break;
     }
-    free(coords);
-
+    stats_free(coords);
+    STATS_PHASE_END(MAZE_PHASE_LINK, timer);
 }
 
 // generate a 3d maze with 6-connected neighbors
 // i.e. any 2 cells who's coords differ by 1 and only 1 in 1 and only 1 dimension are neighbors
-struct maze* gen_maze_3d_6(unsigned long rows, unsigned long cols, unsigned long depth, unsigned long limit, void (*write_step)(const struct maze*, const struct cell*, unsigned int)) {
+struct maze* gen_maze_3d_6(unsigned long rows, unsigned long cols, unsigned long depth, unsigned long limit, struct rng* rng, step_func_t write_step, void* step_ctx) {
     // Init a grid
     unsigned long dims_array[] = {rows, cols, depth};
-    struct maze* out = alloc_maze(3, dims_array);
-
-    // Link cells with walls
-    link_neighs(out);
+    struct maze* out = alloc_grid(3, dims_array);
+    if (!out) return NULL;
 
     // Create a maze starting from a random cell
     // TODO save and return this? something something the maze is a tree?
-    struct cell* start = ((struct cell****)out->maze)
-        [(unsigned long)rand() % out->dims_array[0]]
-        [(unsigned long)rand() % out->dims_array[1]]
-        [(unsigned long)rand() % out->dims_array[2]];
-    gen_maze(start, limit, out, write_step);
+    unsigned long start_coords[3];
+    start_coords[0] = (unsigned long)rng_below(rng, out->dims_array[0]);
+    start_coords[1] = (unsigned long)rng_below(rng, out->dims_array[1]);
+    start_coords[2] = (unsigned long)rng_below(rng, out->dims_array[2]);
+    gen_grid(out, cell_index(out, start_coords), limit, rng, write_step, step_ctx);
     return out;
 }
 
 
 // generate a 2d maze with 4-connected neighbors
 // i.e. any 2 cells who's coords differ by 1 and only 1 in 1 and only 1 dimension are neighbors
-struct maze* gen_maze_4(unsigned long rows, unsigned long cols, unsigned long limit, void (*write_step)(const struct maze*, const struct cell*, unsigned int)) {
+struct maze* gen_maze_4(unsigned long rows, unsigned long cols, unsigned long limit, struct rng* rng, step_func_t write_step, void* step_ctx) {
     // Init a grid
     unsigned long dims_array[] = {rows, cols};
-    struct maze* out = alloc_maze(2, dims_array);
-
-    // Link cells with walls
-    link_neighs(out);
+    struct maze* out = alloc_grid(2, dims_array);
+    if (!out) return NULL;
 
     // Create a maze starting from a random cell
     // TODO save and return this? something something the maze is a tree?
-    struct cell* start = out->maze
-        [(unsigned long)rand() % out->dims_array[0]]
-        [(unsigned long)rand() % out->dims_array[1]];
-    gen_maze(start, limit, out, write_step);
+    unsigned long start_coords[2];
+    start_coords[0] = (unsigned long)rng_below(rng, out->dims_array[0]);
+    start_coords[1] = (unsigned long)rng_below(rng, out->dims_array[1]);
+    gen_grid(out, cell_index(out, start_coords), limit, rng, write_step, step_ctx);
+    return out;
+}
+
+// generate a maze of any number of dimensions, on a grid when it fits in one
+struct maze* gen_maze_nd(unsigned dims, unsigned long* dims_array, unsigned long limit, struct rng* rng, step_func_t write_step, void* step_ctx) {
+    int grid = dims <= GRID_MAX_DIMS;
+    struct maze* out = grid ? alloc_grid(dims, dims_array) : alloc_maze(dims, dims_array);
+    if (!out) return NULL;
+    unsigned long* start_coords = stats_calloc(dims, sizeof(unsigned long));
+    if (!start_coords) {
+        clean_maze(out);
+        return NULL;
+    }
+    if (!grid) link_neighs(out, rng);
+
+    // Create a maze starting from a random cell
+    for (unsigned d = 0; d < dims; d++) {
+        start_coords[d] = (unsigned long)rng_below(rng, out->dims_array[d]);
+    }
+    unsigned long start = cell_index(out, start_coords);
+    stats_free(start_coords);
+
+    if (grid) {
+        gen_grid(out, start, limit, rng, write_step, step_ctx);
+    } else {
+        gen_maze(&out->cells[start], limit, out, write_step, step_ctx);
+    }
     return out;
 }
 
+/**
+ * Build a grid maze from a given starting cell.
+ *
+ * The same depth first search as `gen_maze()`, except that instead of
+ * shuffling each cell's walls up front, a random unvisited neighbor is picked
+ * each time a cell is worked on.
+ */
+void gen_grid(struct maze* maze, unsigned long start, unsigned long limit, struct rng* rng, step_func_t write_step, void* step_ctx) {
+    unsigned int step = 0;
+    if (write_step) write_step(step_ctx, maze, NO_CELL, step++);
+    STATS_PHASE_START(timer);
+    unsigned long len = 0; // TODO describe this
+    grid_cell_t* grid = maze->grid;
+    unsigned dirs = 2 * maze->dims;
+    uint64_t depth = 0, peak_depth = 0, visited = 1;
+
+    // mark visited
+    unsigned long node = start;
+    grid[node] |= GRID_VISITED;
+    while (node != NO_CELL) {
+        // Report the cell before stopping, as it was carved into last time
+        if (write_step) write_step(step_ctx, maze, node, step++);
+        if (limit && len++ >= limit) break;
+
+        // find the unvisited neighbors
+        unsigned choices[2 * GRID_MAX_DIMS];
+        unsigned long neighs[2 * GRID_MAX_DIMS];
+        unsigned num_choices = 0;
+        for (unsigned dir = 0; dir < dirs; dir++) {
+            unsigned long neigh;
+            if (maze_neighbor(maze, node, dir, &neigh) && !(grid[neigh] & GRID_VISITED)) {
+                choices[num_choices] = dir;
+                neighs[num_choices++] = neigh;
+            }
+        }
+
+        if (num_choices == 0) {
+            // backtrack
+            if (GRID_HAS_PARENT(grid[node])) {
+                maze_neighbor(maze, node, GRID_PARENT_DIR(grid[node]), &node);
+                depth--;
+            } else {
+                node = NO_CELL;
+            }
+            continue;
+        }
+
+        // pick one of them
+        unsigned pick = (unsigned)rng_below(rng, num_choices);
+        unsigned dir = choices[pick];
+        unsigned long neigh = neighs[pick];
+
+        // remove the wall, mark as visited and move on
+        grid[node] |= GRID_PASSAGE(dir);
+        grid[neigh] |= GRID_PASSAGE(DIR_OPPOSITE(dir)) | GRID_PARENT(DIR_OPPOSITE(dir)) | GRID_VISITED;
+        node = neigh;
+        visited++;
+        if (++depth > peak_depth) peak_depth = depth;
+    }
+
+    STATS_SEARCH(peak_depth, visited);
+    STATS_PHASE_END(MAZE_PHASE_CARVE, timer);
+    if (write_step) write_step(step_ctx, maze, NO_CELL, step++);
+}
+
 /**
  * Build a maze from a given starting node.
  *
@@ -173,74 +349,60 @@ struct maze* gen_maze_4(unsigned long rows, unsigned long cols, unsigned long li
  * This function has no dependencies on the number of neighbors a node has, so
  * mazes of arbitrary connectedness or size should be generatable.
  */
-void gen_maze(struct cell* node, unsigned long limit, struct maze* maze, void (*write_step)(const struct maze*, const struct cell*, unsigned int)) {
+void gen_maze(struct cell* node, unsigned long limit, struct maze* maze, step_func_t write_step, void* step_ctx) {
     unsigned int step = 0;
-    if (write_step) write_step(maze, NULL, step++);
+    if (write_step) write_step(step_ctx, maze, NO_CELL, step++);
+    STATS_PHASE_START(timer);
     unsigned long len = 0; // TODO describe this
-    // Create a maze
-    stack_t stack = new_stack();
+    uint64_t depth = 0, peak_depth = 0, visited = 1;
 
     // mark visited
     node->visited = 1;
-    // push to stack
-    intmax_t stack_size = 0;
-    stack_push(stack, node); stack_size++;
-    while (stack_peek(stack)) {
+    node->parent = NULL;
+    while (node != NULL) {
+        // Report the cell before stopping, as it was carved into last time
+        if (write_step) write_step(step_ctx, maze, (unsigned long)(node - maze->cells), step++);
         if (limit && len++ >= limit) break;
-        // pop
-        node = (struct cell*) stack_pop(stack); stack_size--;
-        if (write_step) write_step(maze, node, step++);
         // pick an unvisited neighbor
         struct list_node* wall = node->walls.start;
         for (; wall != NULL;) {
             struct list_node* next = wall->next;
             if (!wall->cell->visited) {
-                stack_push(stack, node); stack_size++;
                 // remove the wall
                 list_remove(&node->walls, wall);
                 list_remove_data(&wall->cell->walls, node); // This will will leave us with a tree of paths
                 wall->next = node->paths.start;
                 node->paths.start = wall;
                 if (node->paths.end == NULL) node->paths.end = wall;
-                // mark as visited and push to stack
+                // mark as visited and move on
                 wall->cell->visited = 1;
-                stack_push(stack, wall->cell); stack_size++;
+                wall->cell->parent = node;
+                node = wall->cell;
+                visited++;
+                if (++depth > peak_depth) peak_depth = depth;
                 break;
             }
             wall = next;
         }
+        // no unvisited neighbors, so backtrack
+        if (wall == NULL) {
+            node = node->parent;
+            depth--;
+        }
     }
 
-    if (write_step) write_step(maze, NULL, step++);
-
-    stack_deallocate(stack);
+    STATS_SEARCH(peak_depth, visited);
+    STATS_PHASE_END(MAZE_PHASE_CARVE, timer);
+    if (write_step) write_step(step_ctx, maze, NO_CELL, step++);
 }
 
 
-/* Recursively free each dimension of a maze's cells
- * Args:
- * - dims: the length of the dims_array
- * - dims_array: array of lenths of each dimension
- * - target: the stuff to be freed
- */
-void free_maze_cells(unsigned dims, unsigned long* dims_array, struct cell** target) {
-    if (dims == 0) {
-        struct cell* node = (struct cell*)target;
-        list_deallocate(&node->walls);
-        list_deallocate(&node->paths);
-        free(node->coords);
-        free(node);
-    } else {
-        for (unsigned long i = 0; i < dims_array[0]; i++) {
-            free_maze_cells(dims-1, dims_array+1, (struct cell**)target[i]);
-        }
-        free(target);
-    }
-}
-
 void clean_maze(struct maze* input) {
-    free_maze_cells(input->dims, input->dims_array, (struct cell**)input->maze);
-    free(input->dims_array);
-    free(input);
+    // Every list node came from the pool, so there's no need to walk the lists
+    if (input->pool) pool_deallocate(input->pool);
+    stats_free(input->cells);
+    stats_free(input->grid);
+    stats_free(input->strides);
+    stats_free(input->dims_array);
+    stats_free(input);
 }
-
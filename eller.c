@@ -0,0 +1,129 @@
+#include "eller.h"
+#include "raster.h"
+#include "stats.h"
+#include <stdlib.h> // malloc(), calloc(), free()
+
+/*
+ * Cells that are connected through earlier rows share a set. Sets are
+ * labeled with numbers below `cols`, and relabeled densely for every row so
+ * labels never run out. Within a row, sets are merged with a union-find over
+ * the labels.
+ */
+struct eller {
+    unsigned long rows;
+    unsigned long cols;
+    unsigned long row;        // how many rows have been generated
+    struct rng* rng;
+    unsigned long* labels;    // the set of each cell in the current row
+    unsigned long* parents;   // union-find parent of each label
+    unsigned long* remaining; // cells of each set not yet considered for going south
+    char* south;              // whether each set has gone south yet
+    unsigned long* relabel;   // the label of each set in the next row
+    unsigned long* stamps;    // the row `relabel` was last set for each set
+};
+
+struct eller* new_eller(unsigned long rows, unsigned long cols, struct rng* rng) {
+    STATS_PHASE_START(timer);
+    struct eller* eller = stats_malloc(sizeof(struct eller));
+    eller->rows = rows;
+    eller->cols = cols;
+    eller->row = 0;
+    eller->rng = rng;
+    eller->labels = stats_malloc(cols * sizeof(unsigned long));
+    eller->parents = stats_malloc(cols * sizeof(unsigned long));
+    eller->remaining = stats_malloc(cols * sizeof(unsigned long));
+    eller->south = stats_malloc(cols);
+    eller->relabel = stats_malloc(cols * sizeof(unsigned long));
+    eller->stamps = stats_calloc(cols, sizeof(unsigned long));
+
+    // Every cell of the first row starts out in its own set
+    for (unsigned long c = 0; c < cols; c++) eller->labels[c] = c;
+    STATS_PHASE_END(MAZE_PHASE_ALLOC, timer);
+    return eller;
+}
+
+// Find the set a label currently belongs to, compressing the path on the way
+static unsigned long find(unsigned long* parents, unsigned long label) {
+    unsigned long root = label;
+    while (parents[root] != root) root = parents[root];
+    while (parents[label] != root) {
+        unsigned long next = parents[label];
+        parents[label] = root;
+        label = next;
+    }
+    return root;
+}
+
+int eller_next_row(void* ctx, unsigned char* row) {
+    struct eller* eller = ctx;
+    if (eller->row >= eller->rows) return 1;
+    STATS_PHASE_START(timer);
+    unsigned long cols = eller->cols;
+    int last = eller->row + 1 == eller->rows;
+
+    for (unsigned long c = 0; c < cols; c++) {
+        eller->parents[c] = c;
+        row[c] = ROW_VISITED;
+    }
+
+    // Randomly join neighbors in different sets. The last row has to join
+    // all of them, or the maze wouldn't be connected.
+    for (unsigned long c = 0; c + 1 < cols; c++) {
+        unsigned long a = find(eller->parents, eller->labels[c]);
+        unsigned long b = find(eller->parents, eller->labels[c + 1]);
+        if (a != b && (last || rng_next(eller->rng) >> 63)) {
+            eller->parents[b] = a;
+            row[c] |= ROW_EAST;
+        }
+    }
+
+    if (!last) {
+        // Each set has to go south at least once, or it'd be cut off
+        for (unsigned long c = 0; c < cols; c++) {
+            unsigned long set = find(eller->parents, eller->labels[c]);
+            eller->labels[c] = set;
+            eller->remaining[set] = 0;
+            eller->south[set] = 0;
+        }
+        for (unsigned long c = 0; c < cols; c++) eller->remaining[eller->labels[c]]++;
+
+        unsigned long next_label = 0;
+        unsigned long stamp = eller->row + 1;
+        for (unsigned long c = 0; c < cols; c++) {
+            unsigned long set = eller->labels[c];
+            eller->remaining[set]--;
+            if (rng_next(eller->rng) >> 63 || (eller->remaining[set] == 0 && !eller->south[set])) {
+                eller->south[set] = 1;
+                row[c] |= ROW_SOUTH;
+                // Cells that go south stay in their set
+                if (eller->stamps[set] != stamp) {
+                    eller->stamps[set] = stamp;
+                    eller->relabel[set] = next_label++;
+                }
+                eller->labels[c] = eller->relabel[set];
+            } else {
+                eller->labels[c] = (unsigned long) -1;
+            }
+        }
+
+        // Cells that didn't get a passage from above start their own set
+        for (unsigned long c = 0; c < cols; c++) {
+            if (eller->labels[c] == (unsigned long) -1) eller->labels[c] = next_label++;
+        }
+    }
+
+    eller->row++;
+    STATS_SEARCH(0, cols);
+    STATS_PHASE_END(MAZE_PHASE_CARVE, timer);
+    return 0;
+}
+
+void eller_deallocate(struct eller* eller) {
+    stats_free(eller->labels);
+    stats_free(eller->parents);
+    stats_free(eller->remaining);
+    stats_free(eller->south);
+    stats_free(eller->relabel);
+    stats_free(eller->stamps);
+    stats_free(eller);
+}
@@ -0,0 +1,39 @@
+#ifndef MAZE_GEN_ELLER_H
+#define MAZE_GEN_ELLER_H
+
+#include "rng.h"
+
+/**
+ * Generates a two dimensional maze a row at a time, using Eller's algorithm
+ *
+ * Only the current row is kept, so memory use depends on the number of
+ * columns but not on the number of rows. Rows come out as the flags from
+ * `raster.h`, and the result is a perfect maze.
+ */
+typedef struct eller* eller_t;
+
+/**
+ * Instantiate a new generator for a `rows` by `cols` maze
+ * rng is the source of randomness, and must outlive the generator.
+ */
+eller_t new_eller(unsigned long rows, unsigned long cols, struct rng* rng);
+
+/**
+ * Generate the next row
+ * Matches `row_source_t`, so the generator can be passed as the context of a
+ * row writer. Generating more than `rows` rows is an error.
+ *
+ * Args:
+ * - eller: the generator
+ * - row: output, `cols` long
+ *
+ * Return: 0 on success, nonzero if every row has already been generated
+ */
+int eller_next_row(void* eller, unsigned char* row);
+
+/**
+ * Free the generator
+ */
+void eller_deallocate(eller_t eller);
+
+#endif
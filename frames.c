@@ -0,0 +1,174 @@
+#include "frames.h"
+#include "png_writer.h"
+#include <pthread.h>
+#include <stdint.h> // uint64_t
+#include <stdio.h>
+#include <string.h> // memcpy(), strlen()
+
+// Deltas in the ring. Each is a few hundred bytes.
+#define RING_SIZE 1024
+
+struct frame_pipeline;
+
+/* A worker thread and its copy of the frame */
+struct frame_worker {
+    struct frame_pipeline* pipeline;
+    unsigned id;
+    pthread_t thread;
+    char* frame;
+    uint64_t tail; // deltas this worker is done with. Protected by the lock.
+    int failed;    // whether any frame failed to write
+};
+
+struct frame_pipeline {
+    const char* prefix;
+    size_t width;
+    size_t height;
+    unsigned num_workers;
+    struct frame_worker* workers;
+    struct frame_delta* ring;
+    pthread_mutex_t lock;      // protects everything below
+    pthread_cond_t published;  // signaled when `head` moves or `done` is set
+    pthread_cond_t consumed;   // signaled when a worker's `tail` moves
+    uint64_t head;             // deltas published so far
+    int done;                  // no more deltas are coming
+};
+
+static int write_frame(const struct frame_pipeline* pipeline, const char* frame, unsigned int step) {
+    size_t path_len = strlen(pipeline->prefix) + 16;
+    char* out_file = malloc(path_len);
+    snprintf(out_file, path_len, "%s%04u.png", pipeline->prefix, step);
+    FILE* file = fopen(out_file, "wb");
+    free(out_file);
+    if (!file) return 1;
+
+    int err = 1;
+    png_writer_t writer = new_png_writer(file, pipeline->width, pipeline->height);
+    if (writer) {
+        err = 0;
+        for (size_t y = 0; y < pipeline->height && !err; y++) {
+            err = png_writer_line(writer, frame + y * pipeline->width);
+        }
+        err = png_writer_finish(writer) || err;
+    }
+    return fclose(file) || err;
+}
+
+// Thread entry point: follow the deltas, writing this worker's share of frames
+static void* run_worker(void* arg) {
+    struct frame_worker* worker = arg;
+    struct frame_pipeline* pipeline = worker->pipeline;
+
+    pthread_mutex_lock(&pipeline->lock);
+    uint64_t tail = worker->tail;
+    while (1) {
+        while (tail == pipeline->head && !pipeline->done) {
+            pthread_cond_wait(&pipeline->published, &pipeline->lock);
+        }
+        uint64_t head = pipeline->head;
+        if (tail == head) break;
+        pthread_mutex_unlock(&pipeline->lock);
+
+        // Published deltas won't be overwritten until our tail passes them,
+        // so they can be read without the lock
+        for (; tail < head; tail++) {
+            const struct frame_delta* delta = &pipeline->ring[tail % RING_SIZE];
+            for (unsigned i = 0; i < delta->count; i++) worker->frame[delta->offsets[i]] = delta->values[i];
+            if (delta->step % pipeline->num_workers == worker->id) {
+                worker->failed |= write_frame(pipeline, worker->frame, delta->step);
+                // Free up the slots behind us while we're at it
+                pthread_mutex_lock(&pipeline->lock);
+                worker->tail = tail + 1;
+                pthread_cond_signal(&pipeline->consumed);
+                pthread_mutex_unlock(&pipeline->lock);
+            }
+        }
+
+        pthread_mutex_lock(&pipeline->lock);
+        worker->tail = tail;
+        pthread_cond_signal(&pipeline->consumed);
+    }
+    pthread_mutex_unlock(&pipeline->lock);
+    return NULL;
+}
+
+struct frame_pipeline* new_frame_pipeline(const char* prefix, const char* frame, size_t width, size_t height, unsigned workers) {
+    struct frame_pipeline* pipeline = malloc(sizeof(struct frame_pipeline));
+    pipeline->prefix = prefix;
+    pipeline->width = width;
+    pipeline->height = height;
+    pipeline->ring = malloc(RING_SIZE * sizeof(struct frame_delta));
+    pipeline->head = 0;
+    pipeline->done = 0;
+    pthread_mutex_init(&pipeline->lock, NULL);
+    pthread_cond_init(&pipeline->published, NULL);
+    pthread_cond_init(&pipeline->consumed, NULL);
+
+    if (workers < 1) workers = 1;
+    pipeline->workers = malloc(workers * sizeof(struct frame_worker));
+    pipeline->num_workers = 0;
+    for (unsigned i = 0; i < workers; i++) {
+        struct frame_worker* worker = &pipeline->workers[i];
+        worker->pipeline = pipeline;
+        worker->id = i;
+        worker->tail = 0;
+        worker->failed = 0;
+        worker->frame = malloc(width * height);
+        memcpy(worker->frame, frame, width * height);
+        if (pthread_create(&worker->thread, NULL, run_worker, worker) != 0) {
+            free(worker->frame);
+            break;
+        }
+        pipeline->num_workers++;
+    }
+    return pipeline;
+}
+
+struct frame_delta* frame_pipeline_next(struct frame_pipeline* pipeline, unsigned int step) {
+    // Wait for the slowest worker to be done with the slot
+    pthread_mutex_lock(&pipeline->lock);
+    while (1) {
+        uint64_t slowest = pipeline->head;
+        for (unsigned i = 0; i < pipeline->num_workers; i++) {
+            if (pipeline->workers[i].tail < slowest) slowest = pipeline->workers[i].tail;
+        }
+        if (pipeline->head - slowest < RING_SIZE) break;
+        pthread_cond_wait(&pipeline->consumed, &pipeline->lock);
+    }
+    struct frame_delta* delta = &pipeline->ring[pipeline->head % RING_SIZE];
+    pthread_mutex_unlock(&pipeline->lock);
+
+    delta->step = step;
+    delta->count = 0;
+    return delta;
+}
+
+void frame_pipeline_publish(struct frame_pipeline* pipeline) {
+    pthread_mutex_lock(&pipeline->lock);
+    pipeline->head++;
+    pthread_cond_broadcast(&pipeline->published);
+    pthread_mutex_unlock(&pipeline->lock);
+}
+
+int frame_pipeline_finish(struct frame_pipeline* pipeline) {
+    pthread_mutex_lock(&pipeline->lock);
+    pipeline->done = 1;
+    pthread_cond_broadcast(&pipeline->published);
+    pthread_mutex_unlock(&pipeline->lock);
+
+    // Without any workers, nothing was written
+    int failed = pipeline->num_workers == 0 && pipeline->head > 0;
+    for (unsigned i = 0; i < pipeline->num_workers; i++) {
+        pthread_join(pipeline->workers[i].thread, NULL);
+        failed |= pipeline->workers[i].failed;
+        free(pipeline->workers[i].frame);
+    }
+
+    pthread_cond_destroy(&pipeline->consumed);
+    pthread_cond_destroy(&pipeline->published);
+    pthread_mutex_destroy(&pipeline->lock);
+    free(pipeline->workers);
+    free(pipeline->ring);
+    free(pipeline);
+    return failed;
+}
@@ -0,0 +1,67 @@
+#ifndef MAZE_GEN_FRAMES_H
+#define MAZE_GEN_FRAMES_H
+
+#include <stdlib.h> // size_t
+
+/*
+ * Encodes step frames on worker threads
+ *
+ * Compressing a png per step is far slower than carving a step, so rather
+ * than encoding each frame in the generator's step function, the step
+ * function publishes what changed in the frame since the last step to a
+ * bounded ring of deltas. Every worker keeps its own copy of the frame and
+ * applies every delta in order, so its copy is always at the step of the
+ * delta it's looking at. Each step's frame is encoded by one worker, picked
+ * by step number, so the workers share the encoding between them.
+ *
+ * Once the ring is full, publishing blocks until the slowest worker has
+ * caught up, which bounds memory no matter how far ahead generation gets.
+ */
+typedef struct frame_pipeline* frame_pipeline_t;
+
+/** The most pixels a single step may change */
+#define FRAME_DELTA_MAX 32
+
+/** The pixels changed by a step */
+struct frame_delta {
+    unsigned int step;
+    unsigned count;
+    size_t offsets[FRAME_DELTA_MAX];
+    char values[FRAME_DELTA_MAX];
+};
+
+/**
+ * Start the workers
+ *
+ * Args:
+ * - prefix: frames are written to `<prefix><step>.png`
+ * - frame: the frame before any step, as characters from text-format.h.
+ *   Copied, so it can be changed or freed afterwards.
+ * - width, height: the size of the frame
+ * - workers: how many threads to encode on, at least 1
+ *
+ * Return: The pipeline. Finish with `frame_pipeline_finish()`
+ */
+frame_pipeline_t new_frame_pipeline(const char* prefix, const char* frame, size_t width, size_t height, unsigned workers);
+
+/**
+ * Get the next delta to fill in, waiting for room in the ring if need be
+ * The delta is for `step` and starts out empty. Publish it with
+ * `frame_pipeline_publish()` before getting another.
+ */
+struct frame_delta* frame_pipeline_next(frame_pipeline_t pipeline, unsigned int step);
+
+/**
+ * Hand the delta from `frame_pipeline_next()` to the workers, who will write
+ * its frame
+ */
+void frame_pipeline_publish(frame_pipeline_t pipeline);
+
+/**
+ * Wait for every published frame to be written, then free the pipeline
+ *
+ * Return: 0 if every frame was written, nonzero otherwise
+ */
+int frame_pipeline_finish(frame_pipeline_t pipeline);
+
+#endif
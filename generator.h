@@ -2,6 +2,9 @@
 #define MAZE_GEN_GENERATOR_H
 
 #include "tree.h"
+#include "pool.h"
+#include "rng.h"
+#include <stdint.h> // uint16_t
 #include <stdlib.h> // size_t
 
 #define MAZE_WALL '*'
@@ -18,25 +21,76 @@ struct linked_list {
     struct list_node* start;
     struct list_node* end;
     size_t length;
+    /** Where nodes come from, created with `sizeof(struct list_node)`. NULL to use malloc() */
+    pool_t pool;
 };
 
+void list_init(struct linked_list* list, pool_t pool);
 void list_push(struct linked_list* list, struct cell* cell);
 void list_remove(struct linked_list* list, struct list_node* node);
 void list_remove_data(struct linked_list* list, struct cell* cell);
 void list_deallocate(struct linked_list* list);
 
+/**
+ * A compact grid cell
+ *
+ * Grid mazes store one of these per cell instead of a `struct cell`. Bit `dir`
+ * is set when there is a passage to the neighbor in direction `dir` (see
+ * `DIR_PLUS()` and `DIR_MINUS()`), and `GRID_VISITED` once generation reaches
+ * the cell. Neighbors aren't stored, they're computed from the cell's index.
+ *
+ * The direction back to the cell generation came from is kept in the
+ * `GRID_PARENT_MASK` bits, which lets generation backtrack without a stack.
+ */
+typedef uint16_t grid_cell_t;
+
+/** The most dimensions a grid maze can have, limited by `grid_cell_t` */
+#define GRID_MAX_DIMS 5
+#define GRID_VISITED ((grid_cell_t)0x8000)
+#define GRID_PASSAGE(dir) ((grid_cell_t)(1u << (dir)))
+
+#define GRID_PARENT_SHIFT 10
+#define GRID_PARENT_MASK ((grid_cell_t)(0xFu << GRID_PARENT_SHIFT))
+/** Bits recording that the parent of a cell is in direction `dir` */
+#define GRID_PARENT(dir) ((grid_cell_t)(((dir) + 1u) << GRID_PARENT_SHIFT))
+/** Whether a cell has a parent. The start of generation doesn't. */
+#define GRID_HAS_PARENT(cell) (((cell) & GRID_PARENT_MASK) != 0)
+/** The direction of a cell's parent. Only valid if `GRID_HAS_PARENT()` */
+#define GRID_PARENT_DIR(cell) ((((unsigned)(cell) & GRID_PARENT_MASK) >> GRID_PARENT_SHIFT) - 1u)
+
+/** Direction towards the neighbor at +1 in dimension `d` */
+#define DIR_PLUS(d) (2u * (d))
+/** Direction towards the neighbor at -1 in dimension `d` */
+#define DIR_MINUS(d) (2u * (d) + 1u)
+/** The direction that leads back the way `dir` came */
+#define DIR_OPPOSITE(dir) ((dir) ^ 1u)
+
+/** Passed to a `step_func_t` when there's no current cell */
+#define NO_CELL ((unsigned long)-1)
+
 struct maze {
     unsigned dims;
     long unsigned* dims_array;
-    struct cell*** maze;
+    /** Distance between neighbors in each dimension, in cells */
+    unsigned long* strides;
+    /** Total number of cells, the product of `dims_array` */
+    unsigned long size;
+    /**
+     * All the cells, contiguous and in row-major order. See `cell_index()`
+     * NULL for grid mazes.
+     */
+    struct cell* cells;
+    /** The compact cells of a grid maze, in the same order. NULL otherwise. */
+    grid_cell_t* grid;
+    /** Where the list nodes of `cells` come from. NULL for grid mazes. */
+    pool_t pool;
 };
 
 struct cell {
     struct linked_list walls;
     struct linked_list paths;
-    unsigned long* coords;
-    //unsigned long row;
-    //unsigned long col;
+    /** The cell generation came from, for backtracking. NULL for the start. */
+    struct cell* parent;
     short num_wall;
     short num_path;
     char visited;
@@ -44,6 +98,16 @@ struct cell {
 
 #define NUM_NEIGH 4
 
+/**
+ * Callback for observing generation
+ *
+ * Called once before generation starts and once after it finishes with
+ * `current` set to `NO_CELL`, and once per step in between with the index of
+ * the cell being worked on. `ctx` is whatever pointer was passed alongside the
+ * callback, so a callback needs no global state.
+ */
+typedef void (*step_func_t)(void* ctx, const struct maze* maze, unsigned long current, unsigned int step);
+
 /**
  * Allocate a maze
  *
@@ -55,10 +119,44 @@ struct cell {
  * - dims: length of `dims_array`
  * - dims_array: array of sizes of maze dimensions
  *
- * Return: The allocated maze. Deallocate using `clean_maze()`
+ * The lists of every cell take their nodes from `maze->pool`, so
+ * `clean_maze()` can release all of them at once.
+ *
+ * Return: The allocated maze, or NULL if there are too many cells to
+ *   allocate. Deallocate using `clean_maze()`
  */
 struct maze* alloc_maze(unsigned dims, unsigned long* dims_array);
 
+/**
+ * The most cells in a maze made for a client of `maze --serve` or the Python
+ * module. Bigger requests are refused, as one server or worker process is
+ * shared by many clients.
+ */
+#define MAZE_SERVE_MAX_CELLS (1ul << 24)
+
+/**
+ * Count the cells of a maze, the product of its dimensions
+ *
+ * Return: 0 on success, nonzero if the count doesn't fit in an unsigned long
+ */
+int maze_cell_count(unsigned dims, const unsigned long* dims_array, unsigned long* cells);
+
+/**
+ * Allocate a grid maze
+ *
+ * Like `alloc_maze()`, but the maze is backed by `grid_cell_t`s rather than
+ * linked `struct cell`s, so it takes a couple of bytes per cell. Every cell
+ * starts out walled in and unvisited.
+ *
+ * Args:
+ * - dims: length of `dims_array`, at most `GRID_MAX_DIMS`
+ * - dims_array: array of sizes of maze dimensions
+ *
+ * Return: The allocated maze, or NULL if there are too many dimensions or
+ *   cells to allocate. Deallocate using `clean_maze()`
+ */
+struct maze* alloc_grid(unsigned dims, unsigned long* dims_array);
+
 /**
  * Get a cell from the maze
  *
@@ -74,17 +172,88 @@ struct maze* alloc_maze(unsigned dims, unsigned long* dims_array);
  */
 struct cell* get_cell(struct maze* maze, unsigned long* coords);
 
+/**
+ * Get the linear index of a cell in `maze->cells`
+ *
+ * _THIS FUNCTION DOES NO BOUNDS CHECKING_
+ *
+ * Args:
+ * - maze: the maze the coordinates are in
+ * - coords: the coordinates of the cell, in the order of `maze->dims_array`
+ *
+ * Return: The row-major index of the cell
+ */
+unsigned long cell_index(const struct maze* maze, const unsigned long* coords);
+
+/**
+ * Get the coordinates of a cell in the maze
+ *
+ * Cells don't store their coordinates, they're derived from the cell's index.
+ *
+ * Args:
+ * - maze: the maze the cell belongs to
+ * - cell: the cell to locate
+ * - coords: output array of length `maze->dims`
+ */
+void cell_coords(const struct maze* maze, const struct cell* cell, unsigned long* coords);
+
+/**
+ * Find the neighbor of a cell
+ *
+ * Args:
+ * - maze: the maze the cell is in
+ * - index: the index of the cell
+ * - dir: which neighbor, see `DIR_PLUS()` and `DIR_MINUS()`
+ * - neighbor: set to the index of the neighbor, if there is one
+ *
+ * Return: 1 if the neighbor exists, 0 if it would be outside the maze
+ */
+int maze_neighbor(const struct maze* maze, unsigned long index, unsigned dir, unsigned long* neighbor);
+
+/**
+ * Check whether there's a passage between a cell and its neighbor
+ *
+ * Works on both grid and linked mazes.
+ *
+ * Return: 1 if there's a passage in direction `dir` from the cell, 0 otherwise
+ */
+int maze_passage(const struct maze* maze, unsigned long index, unsigned dir);
+
+/**
+ * Check whether generation has reached a cell
+ *
+ * Works on both grid and linked mazes.
+ */
+int maze_visited(const struct maze* maze, unsigned long index);
+
 /**
  * Link each cell in the maze to its neighbors, populating the `walls` list of
  * each cell
  *
  * Any two cells who's coordinates differ by exactly 1 in 1 and only 1
- * dimension are neighbors.
+ * dimension are neighbors. The walls are shuffled using `rng`.
+ */
+void link_neighs(struct maze* maze, struct rng* rng);
+
+/**
+ * Build a grid maze from a given starting cell.
+ *
+ * Carves passages in place via depth first search, like `gen_maze()`, but
+ * reads and writes the bits of `maze->grid` instead of linked lists.
+ * Backtracking follows the parent bits, so this allocates nothing.
+ *
+ * Args:
+ * * maze: A grid maze from `alloc_grid()`
+ * * start: The index of the cell to start from
+ * * limit: The limit on the number of iterations while generating the path
+ * * rng: The source of randomness
+ * * write_step: Called for each step, may be NULL
+ * * step_ctx: Passed to each call of `write_step`
  */
-void link_neighs(struct maze* maze);
+void gen_grid(struct maze* maze, unsigned long start, unsigned long limit, struct rng* rng, step_func_t write_step, void* step_ctx);
 
 /**
- * Allocate and generate a three dimensional maze using 6-connected neighbors
+ * Allocate and generate a three dimensional grid maze using 6-connected neighbors
  *
  * Uses the definition of neighbors from `link_neighs()`
  *
@@ -93,13 +262,16 @@ void link_neighs(struct maze* maze);
  * * cols: The number of columns in the maze
  * * depth: The number of cells in the third dimension
  * * limit: The limit on the number of iterations while generating the path
+ * * rng: The source of randomness
+ * * write_step: Called for each step, may be NULL
+ * * step_ctx: Passed to each call of `write_step`
  *
  * Return: An allocated maze pointer. Deallocate using `clean_maze()`
  */
-struct maze* gen_maze_3d_6(unsigned long rows, unsigned long cols, unsigned long depth, unsigned long limit, void (*write_step)(const struct maze*, const struct cell*, unsigned int));
+struct maze* gen_maze_3d_6(unsigned long rows, unsigned long cols, unsigned long depth, unsigned long limit, struct rng* rng, step_func_t write_step, void* step_ctx);
 
 /**
- * Allocate and generate a two dimensional maze using 4-connected neighbors
+ * Allocate and generate a two dimensional grid maze using 4-connected neighbors
  *
  * Uses the definition of neighbors from `link_neighs()`
  *
@@ -107,10 +279,55 @@ struct maze* gen_maze_3d_6(unsigned long rows, unsigned long cols, unsigned long
  * * rows: The number of rows in the maze
  * * cols: The number of columns in the maze
  * * limit: The limit on the number of iterations while generating the path
+ * * rng: The source of randomness
+ * * write_step: Called for each step, may be NULL
+ * * step_ctx: Passed to each call of `write_step`
  *
  * Return: An allocated maze pointer. Deallocate using `clean_maze()`
  */
-struct maze* gen_maze_4(unsigned long rows, unsigned long cols, unsigned long limit, void (*write_step)(const struct maze*, const struct cell*, unsigned int));
+struct maze* gen_maze_4(unsigned long rows, unsigned long cols, unsigned long limit, struct rng* rng, step_func_t write_step, void* step_ctx);
+
+/**
+ * Allocate and generate a maze of any number of dimensions
+ *
+ * Mazes of up to `GRID_MAX_DIMS` dimensions are grid mazes, carved like
+ * `gen_maze_4()`. Beyond that, cells are linked with `link_neighs()` and
+ * carved with `gen_maze()`, which takes far more memory per cell.
+ *
+ * Args:
+ * * dims: The number of dimensions, at least 1
+ * * dims_array: The size of each dimension
+ * * limit: The limit on the number of iterations while generating the path
+ * * rng: The source of randomness
+ * * write_step: Called for each step, may be NULL
+ * * step_ctx: Passed to each call of `write_step`
+ *
+ * Return: An allocated maze pointer, or NULL if the maze is too big to
+ *   allocate. Deallocate using `clean_maze()`
+ */
+struct maze* gen_maze_nd(unsigned dims, unsigned long* dims_array, unsigned long limit, struct rng* rng, step_func_t write_step, void* step_ctx);
+
+/**
+ * Allocate and generate a two dimensional grid maze in parallel
+ *
+ * The grid is split into `tile_size` by `tile_size` tiles, which are carved
+ * independently by `threads` threads. The tiles are then joined by opening
+ * one wall between each pair of tiles along a random spanning tree of the
+ * tiles, so the result is still a perfect maze.
+ *
+ * The maze depends only on the random seed and `tile_size`, not on the
+ * number of threads.
+ *
+ * Args:
+ * * rows: The number of rows in the maze
+ * * cols: The number of columns in the maze
+ * * tile_size: The number of rows and columns in each tile
+ * * threads: The number of threads to carve with
+ * * rng: The source of randomness. Each tile gets a generator seeded from it.
+ *
+ * Return: An allocated maze pointer. Deallocate using `clean_maze()`
+ */
+struct maze* gen_maze_4_tiled(unsigned long rows, unsigned long cols, unsigned long tile_size, unsigned threads, struct rng* rng);
 
 /**
  * Build a maze from a given starting node.
@@ -120,8 +337,11 @@ struct maze* gen_maze_4(unsigned long rows, unsigned long cols, unsigned long li
  *
  * This function has no dependencies on the number of neighbors a node has, so
  * mazes of arbitrary connectedness or size should be generatable.
+ *
+ * Backtracking follows each cell's `parent`, so no stack is needed.
+ * `write_step` may be NULL, and is passed `step_ctx` on each call.
  */
-void gen_maze(struct cell* node, unsigned long limit, struct maze* maze, void (*write_step)(const struct maze*, const struct cell*, unsigned int));
+void gen_maze(struct cell* node, unsigned long limit, struct maze* maze, step_func_t write_step, void* step_ctx);
 
 // deconstructs and frees the given maze pointer
 void clean_maze(struct maze* input);
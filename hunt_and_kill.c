@@ -0,0 +1,66 @@
+#include "algorithms.h"
+#include "stats.h"
+
+void carve_hunt_and_kill(struct maze* maze, unsigned long limit, struct rng* rng, step_func_t write_step, void* step_ctx) {
+    unsigned int step = 0;
+    if (write_step) write_step(step_ctx, maze, NO_CELL, step++);
+    STATS_PHASE_START(timer);
+    grid_cell_t* grid = maze->grid;
+    unsigned dirs = 2 * maze->dims;
+    uint64_t walk = 0, peak_walk = 0, visited = 1;
+
+    // Cells before `hunt_from` are all visited. Starting in the first cell
+    // means the first unvisited cell always has a visited neighbor, one with
+    // a lower index, so hunting never has to look past it.
+    unsigned long hunt_from = 0;
+    unsigned long cell = 0;
+    grid[cell] |= GRID_VISITED;
+    if (write_step) write_step(step_ctx, maze, cell, step++);
+
+    while (!(limit && visited >= limit)) {
+        // Kill: walk on to a random unvisited neighbor
+        unsigned choices[2 * GRID_MAX_DIMS];
+        unsigned long neighs[2 * GRID_MAX_DIMS];
+        unsigned num_choices = 0;
+        for (unsigned dir = 0; dir < dirs; dir++) {
+            unsigned long neigh;
+            if (maze_neighbor(maze, cell, dir, &neigh) && !(grid[neigh] & GRID_VISITED)) {
+                choices[num_choices] = dir;
+                neighs[num_choices++] = neigh;
+            }
+        }
+
+        if (num_choices == 0) {
+            // Hunt: find the first unvisited cell, and join it to the maze
+            if (walk > peak_walk) peak_walk = walk;
+            walk = 0;
+            while (hunt_from < maze->size && (grid[hunt_from] & GRID_VISITED)) hunt_from++;
+            if (hunt_from == maze->size) break;
+            cell = hunt_from;
+            for (unsigned dir = 0; dir < dirs; dir++) {
+                unsigned long neigh;
+                if (maze_neighbor(maze, cell, dir, &neigh) && (grid[neigh] & GRID_VISITED)) {
+                    choices[num_choices] = DIR_OPPOSITE(dir);
+                    neighs[num_choices++] = neigh;
+                }
+            }
+            // Carve from the neighbor into the cell
+            unsigned pick = (unsigned) rng_below(rng, num_choices);
+            grid[neighs[pick]] |= GRID_PASSAGE(choices[pick]);
+            grid[cell] |= GRID_PASSAGE(DIR_OPPOSITE(choices[pick])) | GRID_VISITED;
+        } else {
+            unsigned pick = (unsigned) rng_below(rng, num_choices);
+            grid[cell] |= GRID_PASSAGE(choices[pick]);
+            cell = neighs[pick];
+            grid[cell] |= GRID_PASSAGE(DIR_OPPOSITE(choices[pick])) | GRID_VISITED;
+            walk++;
+        }
+        visited++;
+        if (write_step) write_step(step_ctx, maze, cell, step++);
+    }
+    if (walk > peak_walk) peak_walk = walk;
+
+    STATS_SEARCH(peak_walk, visited);
+    STATS_PHASE_END(MAZE_PHASE_CARVE, timer);
+    if (write_step) write_step(step_ctx, maze, NO_CELL, step++);
+}
@@ -0,0 +1,449 @@
+#define _POSIX_C_SOURCE 200112L // pthread_barrier_t
+
+#include "algorithms.h"
+#include "stats.h"
+#include <pthread.h>
+#include <stdlib.h> // malloc(), free()
+#include <string.h> // memmove(), memcpy()
+
+/*
+ * Randomized Kruskal's: shuffle every wall, then open each one that joins two
+ * parts of the maze that aren't joined yet, tracked with a union-find.
+ *
+ * Walls are numbered so the cell and direction come out with a shift, see
+ * `WALL()`. Every wall is looked up in the union-find in random order, so
+ * joining is bound by memory latency, and the cells of walls coming up are
+ * prefetched.
+ *
+ * Threads take the shuffled walls a window at a time, with deterministic
+ * reservations: every wall in the window finds the roots of its two cells and
+ * reserves them, the earliest wall in the window winning each root. A wall
+ * that wins either of its roots is the first wall in the window to touch that
+ * part of the maze, so nothing before it can have joined its cells, and it
+ * links the root it won under the other. The rest try again in the next
+ * window. That opens exactly the walls sequential Kruskal's would, so the
+ * maze doesn't depend on the number of threads.
+ */
+
+// Cells generating a shuffle chunk, at least
+#define CHUNK_CELLS 65536
+// Chunks a shuffle is split into, at most
+#define MAX_CHUNKS 256
+// Walls a shuffle bucket should hold, about
+#define BUCKET_WALLS 16384
+// Most bits of bucket number
+#define MAX_BUCKET_BITS 12
+// Walls in a window, per thread
+#define WINDOW_WALLS 16384
+
+// Walls prefetched ahead of the one being joined
+#define PREFETCH_WALLS 16
+
+/** The wall between `cell` and its neighbor in direction `DIR_PLUS(d)` */
+#define WALL(cell, d) ((cell) << 3 | (d))
+#define WALL_CELL(wall) ((wall) >> 3)
+#define WALL_DIM(wall) ((unsigned) ((wall) & 7))
+
+// An unreserved root
+#define UNRESERVED ((unsigned long) -1)
+
+struct kruskal {
+    struct maze* maze;
+    /** Parent of each cell in the union-find, roots are their own */
+    unsigned long* parent;
+
+    /** The walls, shuffled */
+    unsigned long* walls;
+    unsigned long num_walls;
+
+    /**
+     * The shuffle. Each chunk of cells deals its walls into random buckets,
+     * then each bucket is shuffled, which is as good as shuffling the lot.
+     * Both draw from their own generators, so it's the same on any number of
+     * threads.
+     */
+    unsigned long chunk_cells;
+    unsigned long num_chunks;
+    unsigned bucket_bits;
+    /** Walls each chunk deals into each bucket, then where they go. `[bucket][chunk]` */
+    unsigned long* offsets;
+    uint64_t* chunk_seeds;
+    uint64_t* bucket_seeds;
+
+    /** Chunks or buckets handed out so far */
+    unsigned long next;
+
+    /** The earliest wall in the window to reserve each root */
+    unsigned long* reserved;
+    /** The walls being tried, earliest first */
+    unsigned long* window;
+    unsigned long window_size;
+    /** Walls not put in a window yet */
+    unsigned long unwindowed;
+    /** The roots each wall in the window found, or `NO_CELL` for joined cells */
+    unsigned long* roots;
+    /** Whether each wall in the window is done with */
+    unsigned char* done;
+    /** Walls each thread has left to try again, at the start of its slice */
+    unsigned long* kept;
+
+    unsigned num_threads;
+    pthread_barrier_t barrier;
+    /** Held until the barrier is made */
+    pthread_mutex_t start_lock;
+};
+
+// The cell on the far side of a wall
+static unsigned long wall_far_cell(const struct maze* maze, unsigned long wall) {
+    return WALL_CELL(wall) + maze->strides[WALL_DIM(wall)];
+}
+
+// Fetch the union-find entries of a wall's cells, which are needed soon
+static void prefetch_wall(const struct kruskal* k, unsigned long wall) {
+    __builtin_prefetch(&k->parent[WALL_CELL(wall)]);
+    __builtin_prefetch(&k->parent[wall_far_cell(k->maze, wall)]);
+}
+
+// Open a wall. Cells can have several walls opened at once, hence the atomics.
+static void open_wall(struct maze* maze, unsigned long wall) {
+    unsigned d = WALL_DIM(wall);
+    unsigned long cell = WALL_CELL(wall);
+    __atomic_fetch_or(&maze->grid[cell], GRID_PASSAGE(DIR_PLUS(d)) | GRID_VISITED, __ATOMIC_RELAXED);
+    __atomic_fetch_or(&maze->grid[cell + maze->strides[d]], GRID_PASSAGE(DIR_MINUS(d)) | GRID_VISITED, __ATOMIC_RELAXED);
+}
+
+/**
+ * Find the root of a cell, halving the path on the way
+ * Threads can find at the same time, so each step of the path is swapped in,
+ * and left alone if another thread got there first.
+ */
+static unsigned long find_root(unsigned long* parent, unsigned long cell) {
+    while (1) {
+        unsigned long up = __atomic_load_n(&parent[cell], __ATOMIC_RELAXED);
+        if (up == cell) return cell;
+        unsigned long above = __atomic_load_n(&parent[up], __ATOMIC_RELAXED);
+        if (above != up) {
+            __atomic_compare_exchange_n(&parent[cell], &up, above, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+        }
+        cell = above;
+    }
+}
+
+/**
+ * Link two roots, the lower numbered under the other
+ * Roots are spread about the maze at random, so that keeps the trees about as
+ * shallow as linking by rank would, without keeping ranks.
+ */
+static void link_roots(unsigned long* parent, unsigned long a, unsigned long b) {
+    if (a < b) {
+        __atomic_store_n(&parent[a], b, __ATOMIC_RELAXED);
+    } else {
+        __atomic_store_n(&parent[b], a, __ATOMIC_RELAXED);
+    }
+}
+
+// Reserve a root for the `i`th wall of the window, unless an earlier one has
+static void reserve(unsigned long* slot, unsigned long i) {
+    unsigned long current = __atomic_load_n(slot, __ATOMIC_RELAXED);
+    while (i < current && !__atomic_compare_exchange_n(slot, &current, i, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+// Hand out the next chunk or bucket
+static unsigned long claim(struct kruskal* k) {
+    return __atomic_fetch_add(&k->next, 1, __ATOMIC_RELAXED);
+}
+
+// Deal the walls of a chunk into buckets, counting them if `place` is 0 and
+// putting them in place if it's 1. Both passes draw the same buckets.
+static void deal_chunk(struct kruskal* k, unsigned long chunk, int place) {
+    struct maze* maze = k->maze;
+    struct rng rng;
+    rng_seed(&rng, k->chunk_seeds[chunk]);
+    unsigned long start = chunk * k->chunk_cells;
+    unsigned long end = start + k->chunk_cells < maze->size ? start + k->chunk_cells : maze->size;
+    unsigned long* offsets = k->offsets + chunk;
+
+    // Step through the coordinates rather than dividing them out of each cell
+    unsigned long coords[GRID_MAX_DIMS];
+    for (unsigned d = 0; d < maze->dims; d++) coords[d] = start / maze->strides[d] % maze->dims_array[d];
+    // Buckets are drawn a few at a time from each number
+    uint64_t bits = 0;
+    unsigned bits_left = 0;
+
+    for (unsigned long cell = start; cell < end; cell++) {
+        if (!place) k->parent[cell] = cell;
+        for (unsigned d = 0; d < maze->dims; d++) {
+            if (coords[d] + 1 >= maze->dims_array[d]) continue;
+            if (bits_left < k->bucket_bits) {
+                bits = rng_next(&rng);
+                bits_left = 64;
+            }
+            unsigned long bucket = (unsigned long) (bits & ((1ul << k->bucket_bits) - 1));
+            bits >>= k->bucket_bits;
+            bits_left -= k->bucket_bits;
+            unsigned long* offset = &offsets[bucket * k->num_chunks];
+            if (place) {
+                k->walls[(*offset)++] = WALL(cell, d);
+            } else {
+                (*offset)++;
+            }
+        }
+        for (unsigned d = maze->dims; d-- > 0 && ++coords[d] == maze->dims_array[d];) coords[d] = 0;
+    }
+}
+
+// Fisher-Yates shuffle a bucket
+static void shuffle_bucket(struct kruskal* k, unsigned long bucket) {
+    struct rng rng;
+    rng_seed(&rng, k->bucket_seeds[bucket]);
+    // Dealing moved each bucket's offsets to where the next bucket starts
+    unsigned long end = k->offsets[(bucket + 1) * k->num_chunks - 1];
+    unsigned long start = bucket ? k->offsets[bucket * k->num_chunks - 1] : 0;
+    for (unsigned long i = end - start; i > 1; i--) {
+        unsigned long j = start + (unsigned long) rng_below(&rng, i);
+        unsigned long wall = k->walls[start + i - 1];
+        k->walls[start + i - 1] = k->walls[j];
+        k->walls[j] = wall;
+    }
+}
+
+// Turn the counts into where each chunk's walls for each bucket start
+static void count_to_offsets(struct kruskal* k) {
+    unsigned long entries = k->num_chunks << k->bucket_bits, total = 0;
+    for (unsigned long i = 0; i < entries; i++) {
+        unsigned long count = k->offsets[i];
+        k->offsets[i] = total;
+        total += count;
+    }
+}
+
+// Fill the window up with the walls to try next, after the ones to try again
+static void next_window(struct kruskal* k) {
+    unsigned long size = 0;
+    for (unsigned t = 0; t < k->num_threads; t++) {
+        unsigned long start = k->window_size * t / k->num_threads;
+        memmove(k->window + size, k->window + start, k->kept[t] * sizeof(unsigned long));
+        size += k->kept[t];
+    }
+    unsigned long more = WINDOW_WALLS * (unsigned long) k->num_threads - size;
+    if (more > k->unwindowed) more = k->unwindowed;
+    memcpy(k->window + size, k->walls + k->num_walls - k->unwindowed, more * sizeof(unsigned long));
+    k->unwindowed -= more;
+    k->window_size = size + more;
+}
+
+// Wait for every thread. Returns 1 in exactly one of them.
+static int wait_all(struct kruskal* k) {
+    return pthread_barrier_wait(&k->barrier) == PTHREAD_BARRIER_SERIAL_THREAD;
+}
+
+/**
+ * Try a slice of the window
+ *
+ * Return: How many walls are left to try again, now at the start of the slice
+ */
+static unsigned long try_slice(struct kruskal* k, unsigned long start, unsigned long end) {
+    struct maze* maze = k->maze;
+    unsigned long* roots = k->roots;
+
+    for (unsigned long i = start; i < end; i++) {
+        unsigned long wall = k->window[i];
+        if (i + PREFETCH_WALLS < end) prefetch_wall(k, k->window[i + PREFETCH_WALLS]);
+        unsigned long near = find_root(k->parent, WALL_CELL(wall));
+        unsigned long far = find_root(k->parent, wall_far_cell(maze, wall));
+        k->done[i] = near == far;
+        roots[2 * i] = near == far ? NO_CELL : near;
+        roots[2 * i + 1] = far;
+        if (near != far) {
+            reserve(&k->reserved[near], i);
+            reserve(&k->reserved[far], i);
+        }
+    }
+    wait_all(k);
+
+    // Each root is won by one wall at most, so no swapping is needed to link
+    for (unsigned long i = start; i < end; i++) {
+        unsigned long near = roots[2 * i], far = roots[2 * i + 1];
+        if (near == NO_CELL) continue;
+        int won_near = k->reserved[near] == i, won_far = k->reserved[far] == i;
+        if (won_near && won_far) {
+            link_roots(k->parent, near, far);
+        } else if (won_near) {
+            __atomic_store_n(&k->parent[near], far, __ATOMIC_RELAXED);
+        } else if (won_far) {
+            __atomic_store_n(&k->parent[far], near, __ATOMIC_RELAXED);
+        } else {
+            continue;
+        }
+        open_wall(maze, k->window[i]);
+        k->done[i] = 1;
+    }
+    wait_all(k);
+
+    unsigned long kept = 0;
+    for (unsigned long i = start; i < end; i++) {
+        if (roots[2 * i] != NO_CELL) {
+            __atomic_store_n(&k->reserved[roots[2 * i]], UNRESERVED, __ATOMIC_RELAXED);
+            __atomic_store_n(&k->reserved[roots[2 * i + 1]], UNRESERVED, __ATOMIC_RELAXED);
+        }
+        if (!k->done[i]) k->window[start + kept++] = k->window[i];
+    }
+    return kept;
+}
+
+/* A thread working on a `struct kruskal`, and which one it is */
+struct kruskal_thread {
+    struct kruskal* k;
+    unsigned id;
+    pthread_t thread;
+};
+
+// Every thread's share of the work
+static void* run_kruskal(void* arg) {
+    struct kruskal_thread* self = arg;
+    struct kruskal* k = self->k;
+
+    // Count which buckets the walls go in, put them there and shuffle them
+    for (unsigned long chunk; (chunk = claim(k)) < k->num_chunks;) deal_chunk(k, chunk, 0);
+    if (wait_all(k)) {
+        count_to_offsets(k);
+        k->next = 0;
+    }
+    wait_all(k);
+    for (unsigned long chunk; (chunk = claim(k)) < k->num_chunks;) deal_chunk(k, chunk, 1);
+    if (wait_all(k)) k->next = 0;
+    wait_all(k);
+    for (unsigned long bucket; (bucket = claim(k)) < (1ul << k->bucket_bits);) shuffle_bucket(k, bucket);
+    if (wait_all(k) && k->reserved) next_window(k);
+    wait_all(k);
+
+    // Then join them, unless a single thread is doing it
+    if (!k->reserved) return NULL;
+    while (k->window_size > 0) {
+        unsigned long start = k->window_size * self->id / k->num_threads;
+        unsigned long end = k->window_size * (self->id + 1) / k->num_threads;
+        k->kept[self->id] = try_slice(k, start, end);
+        if (wait_all(k)) next_window(k);
+        wait_all(k);
+    }
+    return NULL;
+}
+
+// Thread entry point: wait until every thread has started, then work
+static void* start_kruskal(void* arg) {
+    struct kruskal* k = ((struct kruskal_thread*) arg)->k;
+    pthread_mutex_lock(&k->start_lock);
+    pthread_mutex_unlock(&k->start_lock);
+    return run_kruskal(arg);
+}
+
+/**
+ * Generate with `threads` threads, or the walls in order on this one if it's
+ * just the one, which can stop early and report steps
+ */
+static void kruskal(struct maze* maze, struct rng* rng, unsigned threads, unsigned long limit,
+        step_func_t write_step, void* step_ctx) {
+    unsigned int step = 0;
+    if (write_step) write_step(step_ctx, maze, NO_CELL, step++);
+    STATS_PHASE_START(timer);
+
+    struct kruskal k;
+    k.maze = maze;
+    k.num_walls = 0;
+    for (unsigned d = 0; d < maze->dims; d++) k.num_walls += maze->size / maze->dims_array[d] * (maze->dims_array[d] - 1);
+    k.parent = stats_malloc(maze->size * sizeof(unsigned long));
+    k.walls = stats_malloc((k.num_walls ? k.num_walls : 1) * sizeof(unsigned long));
+
+    // Everything here depends only on the size of the maze, so the shuffle
+    // doesn't depend on the number of threads
+    k.num_chunks = (maze->size + CHUNK_CELLS - 1) / CHUNK_CELLS;
+    if (k.num_chunks > MAX_CHUNKS) k.num_chunks = MAX_CHUNKS;
+    k.chunk_cells = (maze->size + k.num_chunks - 1) / k.num_chunks;
+    k.bucket_bits = 0;
+    while (k.bucket_bits < MAX_BUCKET_BITS && (k.num_walls >> k.bucket_bits) > BUCKET_WALLS) k.bucket_bits++;
+    unsigned long num_buckets = 1ul << k.bucket_bits;
+    k.offsets = stats_calloc(k.num_chunks << k.bucket_bits, sizeof(unsigned long));
+    k.chunk_seeds = stats_malloc(k.num_chunks * sizeof(uint64_t));
+    k.bucket_seeds = stats_malloc(num_buckets * sizeof(uint64_t));
+    for (unsigned long c = 0; c < k.num_chunks; c++) k.chunk_seeds[c] = rng_next(rng);
+    for (unsigned long b = 0; b < num_buckets; b++) k.bucket_seeds[b] = rng_next(rng);
+    k.next = 0;
+
+    k.reserved = NULL;
+    k.window_size = 0;
+    k.unwindowed = k.num_walls;
+    if (threads < 1) threads = 1;
+    if (threads > 1) {
+        unsigned long window_walls = WINDOW_WALLS * (unsigned long) threads;
+        k.reserved = stats_malloc(maze->size * sizeof(unsigned long));
+        for (unsigned long i = 0; i < maze->size; i++) k.reserved[i] = UNRESERVED;
+        k.window = stats_malloc(window_walls * sizeof(unsigned long));
+        k.roots = stats_malloc(2 * window_walls * sizeof(unsigned long));
+        k.done = stats_malloc(window_walls);
+        k.kept = stats_malloc(threads * sizeof(unsigned long));
+        for (unsigned t = 0; t < threads; t++) k.kept[t] = 0;
+    }
+
+    // The barrier is made for however many threads could be started
+    struct kruskal_thread* workers = stats_malloc(threads * sizeof(struct kruskal_thread));
+    pthread_mutex_init(&k.start_lock, NULL);
+    pthread_mutex_lock(&k.start_lock);
+    workers[0].k = &k;
+    workers[0].id = 0;
+    for (k.num_threads = 1; k.num_threads < threads; k.num_threads++) {
+        struct kruskal_thread* worker = &workers[k.num_threads];
+        worker->k = &k;
+        worker->id = k.num_threads;
+        if (pthread_create(&worker->thread, NULL, start_kruskal, worker) != 0) break;
+    }
+    pthread_barrier_init(&k.barrier, NULL, k.num_threads);
+    pthread_mutex_unlock(&k.start_lock);
+    run_kruskal(&workers[0]);
+    for (unsigned t = 1; t < k.num_threads; t++) pthread_join(workers[t].thread, NULL);
+    pthread_barrier_destroy(&k.barrier);
+    pthread_mutex_destroy(&k.start_lock);
+
+    uint64_t visited = 1;
+    if (k.reserved) {
+        visited = maze->size;
+        stats_free(k.reserved);
+        stats_free(k.window);
+        stats_free(k.roots);
+        stats_free(k.done);
+        stats_free(k.kept);
+    } else {
+        for (unsigned long i = 0; i < k.num_walls && !(limit && visited >= limit); i++) {
+            unsigned long wall = k.walls[i];
+            if (i + PREFETCH_WALLS < k.num_walls) prefetch_wall(&k, k.walls[i + PREFETCH_WALLS]);
+            unsigned long near = find_root(k.parent, WALL_CELL(wall));
+            unsigned long far = find_root(k.parent, wall_far_cell(maze, wall));
+            if (near == far) continue;
+            link_roots(k.parent, near, far);
+            open_wall(maze, wall);
+            visited++;
+            if (write_step) write_step(step_ctx, maze, WALL_CELL(wall), step++);
+        }
+    }
+    // Otherwise a maze of one cell is never reached
+    if (maze->size == 1) maze->grid[0] |= GRID_VISITED;
+
+    stats_free(workers);
+    stats_free(k.bucket_seeds);
+    stats_free(k.chunk_seeds);
+    stats_free(k.offsets);
+    stats_free(k.walls);
+    stats_free(k.parent);
+
+    STATS_SEARCH(0, visited);
+    STATS_PHASE_END(MAZE_PHASE_CARVE, timer);
+    if (write_step) write_step(step_ctx, maze, NO_CELL, step++);
+}
+
+void carve_kruskal(struct maze* maze, unsigned long limit, struct rng* rng, step_func_t write_step, void* step_ctx) {
+    kruskal(maze, rng, 1, limit, write_step, step_ctx);
+}
+
+void carve_kruskal_threads(struct maze* maze, struct rng* rng, unsigned threads) {
+    kruskal(maze, rng, threads, 0, NULL, NULL);
+}
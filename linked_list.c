@@ -1,7 +1,29 @@
 #include "generator.h"
+#include "stats.h"
+
+void list_init(struct linked_list* list, pool_t pool) {
+    list->start = NULL;
+    list->end = NULL;
+    list->length = 0;
+    list->pool = pool;
+}
+
+// Release a node to wherever it came from
+static void free_node(struct linked_list* list, struct list_node* node) {
+    if (list->pool) {
+        pool_free(list->pool, node);
+    } else {
+        stats_free(node);
+    }
+}
 
 void list_push(struct linked_list* list, struct cell* cell) {
-    struct list_node* new = malloc(sizeof(struct list_node));
+    struct list_node* new;
+    if (list->pool) {
+        new = pool_alloc(list->pool);
+    } else {
+        new = stats_malloc(sizeof(struct list_node));
+    }
     new->cell = cell;
     new->next = NULL;
     new->prev = list->end;
@@ -21,7 +43,7 @@ void list_remove_data(struct linked_list* list, struct cell* cell) {
     for (struct list_node* node = list->start; node != NULL; node = node->next) {
         if (node->cell == cell) {
             list_remove(list, node);
-            free(node);
+            free_node(list, node);
             break;
         }
     }
@@ -31,7 +53,7 @@ void list_deallocate(struct linked_list* list) {
     struct list_node* tmp;
     for (struct list_node* node = list->start; node != NULL;) {
         tmp = node->next;
-        free(node);
+        free_node(list, node);
         node = tmp;
     }
 }
@@ -1,14 +1,30 @@
+#define _POSIX_C_SOURCE 200809L // sysconf()
+
 #include "stack.h"
 #include "tree.h"
 #include "generator.h"
+#include "raster.h"
+#include "png_writer.h"
+#include "mazefile.h"
+#include "maze_writer.h"
+#include "server.h"
+#include "cache.h"
+#include "stats.h"
+#include "trace.h"
+#include "frames.h"
+#include "solve.h"
+#include "algorithms.h"
+#include "tar.h"
+#include <pthread.h>
 #include <stdio.h>
 #include <stdint.h> // intmax_t
-#include <img.h>
-#include <stdlib.h> // calloc(), srand(), atexit()
+#include <stdlib.h> // calloc(), atexit()
 #include <string.h> // strcmp(), strstr()
-#include <time.h>   // time()
+#include <time.h>   // time(), clock_gettime()
+#include <unistd.h> // sysconf()
 
 #include "format.h" // ANSI formatting escape sequences
+#include "text-format.h"
 
 #define STRINGIFY2(X) #X
 #define STRINGIFY(X) STRINGIFY2(X)
@@ -17,17 +33,31 @@
 #define DEFAULT_SIZE 50
 // Default output path and format
 #define DEFAULT_OUTFILE "maze.png"
+// Default output prefix with --count
+#define DEFAULT_BATCH_PREFIX "maze"
+
+/** The output path that means stdout */
+#define STDOUT_PATH "-"
 #define DEFAULT_OUT_FORMAT "png"
-#define VALID_OUT_FORMATS "{png|text}"
+#define VALID_OUT_FORMATS "{png|text|bin}"
 
 #define DEFAULT_SEED time(0)
 
+// The most dimensions --dims takes
+#define MAX_DIMS 16
+
+// Tile size used for parallel generation if not specified by flags
+#define DEFAULT_TILE_SIZE 256
+
+// Cache size limit in megabytes if not specified by flags
+#define DEFAULT_CACHE_SIZE 256
+
 /** The usage message */
 char* usage;
 
 /** Arguments for the usage message */
 static const char* args_doc =
-    "[-h] [--size size] [--rows num_rows] [--cols num_cols] [--seed seed] [--path-len length] [-f output_path] [--format "VALID_OUT_FORMATS"]";
+    "[-h] [--size size] [--rows num_rows] [--cols num_cols] [--depth depth] [--dims size,size,...] [--seed seed] [--algorithm name] [--path-len length] [--threads num_threads] [--tile-size size] [--stream] [--serve socket_path] [--cache-dir dir] [--cache-size megabytes] [--stats] [--trace trace_file] [--solve] [--solve-from row,col] [--solve-to row,col] [--slices prefix] [--batch spec_file] [--count num_mazes --seed-prefix prefix] [--jobs num_jobs] [--tar archive] [-f output_path] [--format "VALID_OUT_FORMATS"]";
 
 /** Help message, much more detailed than usage, and with pretty formatting */
 static const char* help = BOLD "Options" INTENSITY_RESET "\n"
@@ -35,62 +65,106 @@ TAB BOLD"-h"INTENSITY_RESET":\n"TAB TAB"print this help message\n"
 TAB BOLD"--size"INTENSITY_RESET" "UNDERLINE"size"UNDERLINE_OFF":\n"TAB TAB"create a maze that is "UNDERLINE"size"UNDERLINE_OFF" rows by "UNDERLINE"size"UNDERLINE_OFF" columns (overridden by --rows and --cols). default: "STRINGIFY(DEFAULT_SIZE)"\n"
 TAB BOLD"--rows"INTENSITY_RESET" "UNDERLINE"num_rows"UNDERLINE_OFF":\n"TAB TAB"sets the maze size to "UNDERLINE"num_rows"UNDERLINE_OFF" rows\n"
 TAB BOLD"--cols"INTENSITY_RESET" "UNDERLINE"num_cols"UNDERLINE_OFF":\n"TAB TAB"sets the maze size to "UNDERLINE"num_cols"UNDERLINE_OFF" columns\n"
+TAB BOLD"--depth"INTENSITY_RESET" "UNDERLINE"depth"UNDERLINE_OFF":\n"TAB TAB"make the maze three dimensional, with "UNDERLINE"depth"UNDERLINE_OFF" layers of rows by columns\n"
+TAB BOLD"--dims"INTENSITY_RESET" "UNDERLINE"size,size,..."UNDERLINE_OFF":\n"TAB TAB"the size of each dimension of the maze, up to "STRINGIFY(MAX_DIMS)" of them (overrides --size, --rows, --cols and --depth). The last two are the rows and columns of each layer. Three dimensional mazes are written as a sheet of their layers side by side, with cells that lead to the next layer marked '^', the previous one 'v' and both 'x'. Mazes of more than three dimensions can only be written with --format bin. Can't be combined with --threads (except with kruskal), --stream, --write-steps, --trace or --solve\n"
 TAB BOLD"--seed"INTENSITY_RESET" "UNDERLINE"seed"UNDERLINE_OFF":\n"TAB TAB"specify a seed for the random number generator\n"
+TAB BOLD"--algorithm"INTENSITY_RESET" "UNDERLINE"name"UNDERLINE_OFF":\n"TAB TAB"how to generate the maze, one of: "MAZE_ALGORITHMS". binary-tree, sidewinder and eller work a row at a time, so they're the fastest and the only ones that can --stream, but only make two dimensional mazes. default: "MAZE_DEFAULT_ALGORITHM", or eller with --stream\n"
+TAB BOLD"--print-valid-algorithms"INTENSITY_RESET":\n"TAB TAB"print the valid algorithm names, one per line, and exit\n"
 TAB BOLD"--path-len"INTENSITY_RESET" "UNDERLINE"length"UNDERLINE_OFF":\n"TAB TAB"limit the length of the path.  default: no limit (0)\n"
-TAB BOLD"-f"INTENSITY_RESET" "UNDERLINE"output_path"UNDERLINE_OFF":\n"TAB TAB"where to write the maze png to. default: "STRINGIFY(DEFAULT_OUTFILE)"\n"
+TAB BOLD"--threads"INTENSITY_RESET" "UNDERLINE"num_threads"UNDERLINE_OFF":\n"TAB TAB"carve the maze in parallel on "UNDERLINE"num_threads"UNDERLINE_OFF" threads, in tiles with dfs or a window of walls at a time with kruskal. The maze doesn't depend on the number of threads. Can't be combined with --path-len, --write-steps or --trace\n"
+TAB BOLD"--tile-size"INTENSITY_RESET" "UNDERLINE"size"UNDERLINE_OFF":\n"TAB TAB"the rows and columns in each tile when using --threads with dfs. default: "STRINGIFY(DEFAULT_TILE_SIZE)"\n"
+TAB BOLD"--stream"INTENSITY_RESET":\n"TAB TAB"generate the maze a row at a time with Eller's algorithm, or another --algorithm that works a row at a time, writing each row as soon as it's generated. Memory use doesn't grow with the number of rows. Can't be combined with --threads, --path-len, --write-steps or --trace\n";
+
+/** The rest of the help message, split off to keep each string a length every compiler takes */
+static const char* help_more =
+TAB BOLD"--serve"INTENSITY_RESET" "UNDERLINE"socket_path"UNDERLINE_OFF":\n"TAB TAB"serve mazes over a Unix socket at "UNDERLINE"socket_path"UNDERLINE_OFF" until killed, instead of writing one. See server.h for the protocol. Other flags are ignored\n"
+TAB BOLD"--cache-dir"INTENSITY_RESET" "UNDERLINE"dir"UNDERLINE_OFF":\n"TAB TAB"reuse mazes from, and store mazes in, the cache in "UNDERLINE"dir"UNDERLINE_OFF". Only mazes with a --seed are cached, and not with --stream, --write-steps or --trace. Works with --serve\n"
+TAB BOLD"--cache-size"INTENSITY_RESET" "UNDERLINE"megabytes"UNDERLINE_OFF":\n"TAB TAB"the most the cache directory may hold before old mazes are evicted. default: "STRINGIFY(DEFAULT_CACHE_SIZE)"\n"
+TAB BOLD"--stats"INTENSITY_RESET":\n"TAB TAB"print how long each phase took, the allocations made and how the search went to stderr, as JSON. With --stream, encoding includes writing\n"
+TAB BOLD"--trace"INTENSITY_RESET" "UNDERLINE"trace_file"UNDERLINE_OFF":\n"TAB TAB"record every step of generation to "UNDERLINE"trace_file"UNDERLINE_OFF", a byte per step, for rendering later with replay-trace. See trace.h for the format. Can't be combined with --write-steps\n"
+TAB BOLD"--solve"INTENSITY_RESET":\n"TAB TAB"draw the path through the maze, from the top left corner to the bottom right one unless --solve-from or --solve-to say otherwise. Can't be combined with --stream or --format bin\n"
+TAB BOLD"--solve-from"INTENSITY_RESET" "UNDERLINE"row,col"UNDERLINE_OFF":\n"TAB TAB"start the path at the cell at "UNDERLINE"row,col"UNDERLINE_OFF", counting from 0. Implies --solve\n"
+TAB BOLD"--solve-to"INTENSITY_RESET" "UNDERLINE"row,col"UNDERLINE_OFF":\n"TAB TAB"end the path at the cell at "UNDERLINE"row,col"UNDERLINE_OFF". Implies --solve\n"
+TAB BOLD"--slices"INTENSITY_RESET" "UNDERLINE"prefix"UNDERLINE_OFF":\n"TAB TAB"instead of a sheet, write each layer as '"UNDERLINE"prefix"UNDERLINE_OFF"<number>.png', or .txt for --format text. Can't be combined with --stream, --solve or --format bin\n"
+TAB BOLD"-f"INTENSITY_RESET" "UNDERLINE"output_path"UNDERLINE_OFF":\n"TAB TAB"where to write the maze png to, or "STRINGIFY(STDOUT_PATH)" for stdout. With --count, the start of each maze's path instead. default: "STRINGIFY(DEFAULT_OUTFILE)", or "STRINGIFY(DEFAULT_BATCH_PREFIX)" with --count\n"
 TAB BOLD"--format"INTENSITY_RESET" "UNDERLINE""VALID_OUT_FORMATS""UNDERLINE_OFF":\n"TAB TAB"what format to use when writing to the output default: "STRINGIFY(DEFAULT_OUT_FORMAT)"\n"
 TAB BOLD"--print-valid-formats"INTENSITY_RESET":\n"TAB TAB"print the valid format strings, one per line, and exit\n"
 TAB BOLD"--write-steps"INTENSITY_RESET" "UNDERLINE"prefix"UNDERLINE_OFF":\n"TAB TAB"write each step of maze generation as '"UNDERLINE"prefix"UNDERLINE_OFF"<number>.png'\n";
 
+/** Help for making many mazes at once */
+static const char* help_batch =
+TAB BOLD"--batch"INTENSITY_RESET" "UNDERLINE"spec_file"UNDERLINE_OFF":\n"TAB TAB"make a maze for each line of "UNDERLINE"spec_file"UNDERLINE_OFF", which holds that maze's flags separated by whitespace, on top of the other flags given. Blank lines and lines starting with '#' are skipped. Lines without --seed are seeded from the time and their number. The flags below, --serve, --cache-dir, --cache-size and --stats only go on the command line\n"
+TAB BOLD"--count"INTENSITY_RESET" "UNDERLINE"num_mazes"UNDERLINE_OFF":\n"TAB TAB"make "UNDERLINE"num_mazes"UNDERLINE_OFF" mazes, numbered from 0, each seeded with --seed-prefix followed by its number and written to -f followed by its number and the format's extension. Can't be combined with --seed, --write-steps, --trace or --slices\n"
+TAB BOLD"--seed-prefix"INTENSITY_RESET" "UNDERLINE"prefix"UNDERLINE_OFF":\n"TAB TAB"the start of each seed with --count, which it's required with\n"
+TAB BOLD"--jobs"INTENSITY_RESET" "UNDERLINE"num_jobs"UNDERLINE_OFF":\n"TAB TAB"make the mazes of --batch or --count on "UNDERLINE"num_jobs"UNDERLINE_OFF" threads at once. The mazes per second are printed to stderr at the end, and --stats adds up every maze's. default: the number of cores\n"
+TAB BOLD"--tar"INTENSITY_RESET" "UNDERLINE"archive"UNDERLINE_OFF":\n"TAB TAB"write the mazes of --batch or --count into the tar archive "UNDERLINE"archive"UNDERLINE_OFF", each under its path, instead of to their own files. They're added as they finish. "STRINGIFY(STDOUT_PATH)" writes the archive to stdout. Can't be combined with --stream or --slices\n";
+
 /** Arguments struct  */
 struct arguments {
     /** Number of rows in the output maze */
     unsigned long rows;
     /** Number of columns in the output maze */
     unsigned long cols;
+    /** Number of dimensions, with `rows` and `cols` the last two */
+    unsigned dims;
+    /** Size of each dimension */
+    unsigned long dims_array[MAX_DIMS];
     /** Seed to control rng */
-    unsigned int seed;
+    uint64_t seed;
+    /** Whether the seed was given, rather than from the time */
+    int seeded;
+    /** How to generate the maze */
+    const struct maze_algorithm* algorithm;
     /** Path length limit */
     unsigned long limit;
+    /** Threads to generate with, or 0 to generate without tiling */
+    unsigned threads;
+    /** Size of tiles when generating with threads */
+    unsigned long tile_size;
+    /** Generate a row at a time, writing each row as it's generated */
+    int stream;
     /** Out file name */
     const char* out_file;
     /** Out format */
     const char* out_format;
+    /**
+     * If this isn't NULL, we'll write each step of the maze generation as a
+     * separate png. This allows for visual examination of the process, or for
+     * making a gif.
+     */
+    const char* write_steps_prefix;
+    /** If this isn't NULL, write each layer to its own file starting with this */
+    const char* slices_prefix;
+    /** If this isn't NULL, record a trace of the generation to this file */
+    const char* trace_path;
+    /** Unix socket to serve mazes on, or NULL to generate a single maze */
+    const char* serve_path;
+    /** Directory to cache mazes in, or NULL to not cache */
+    const char* cache_dir;
+    /** Size limit of the cache in megabytes */
+    unsigned long cache_size;
+    /** Print stats to stderr */
+    int stats;
+    /** Draw the path between two cells */
+    int solve;
+    /** If this isn't NULL, make a maze for each line of this file */
+    const char* batch_path;
+    /** Mazes to make with seeds starting with `seed_prefix`, or 0 */
+    unsigned long count;
+    const char* seed_prefix;
+    /** Threads to make a batch of mazes on, or 0 for one per core */
+    unsigned jobs;
+    /** If this isn't NULL, write a batch of mazes into this tar archive */
+    const char* tar_path;
+    /** The archive to write to instead of `out_file`, if any */
+    tar_writer_t tar;
+    /** The cells to draw the path between, as row and column */
+    unsigned long solve_from[2];
+    unsigned long solve_to[2];
     /** Exit immediately flag */
     //volatile short exit; // TODO
 };
 
-/**
- * If this isn't NULL, we'll write each step of the maze generation as a
- * separate png. This allows for visual examination of the process, or for
- * making a gif.
- *
- * this is a global because I need to access it in the write_steps function
- */
-volatile char* write_steps_prefix;
-
-/**
- * Hash a string to an int.
- *
- * Uses a slight modification of `djb2` (credit to
- * http://www.cse.yorku.ca/~oz/hash.html)
- */
-unsigned int hash_string(unsigned const char* str) {
-    unsigned long hash = 5381;
-    unsigned char c;
-    while ((c = *str++)) {
-        hash = ((hash << 5) + hash) ^ c;
-    }
-
-    unsigned int out = 0;
-    for (size_t i = 0; i < sizeof(hash) / sizeof(out); i++) {
-        out ^= (unsigned int) hash;
-        hash = hash >> (sizeof(out) * 8);
-    }
-
-    return out;
-}
-
 //void relocate(struct cell* c) {
     //c->row = c->row * 2 + 1;
     //c->col = c->col * 2 + 1;
@@ -121,6 +195,41 @@ static char* get_usage(const int argc, const char** argv) {
     return usage_msg;
 }
 
+/**
+ * Parse a cell given as "row,col"
+ *
+ * Return: 0 on success, nonzero if `str` isn't a cell
+ */
+static int parse_cell(const char* str, unsigned long* cell) {
+    char* endptr;
+    if (*str < '0' || *str > '9') return 1;
+    cell[0] = strtoul(str, &endptr, 10);
+    if (*endptr != ',' || endptr[1] < '0' || endptr[1] > '9') return 1;
+    cell[1] = strtoul(endptr + 1, &endptr, 10);
+    return *endptr != '\0';
+}
+
+/**
+ * Parse the sizes of dimensions, given as "size,size,..."
+ *
+ * Return: 0 on success, nonzero if `str` isn't a list of 2 to `MAX_DIMS`
+ *   positive sizes
+ */
+static int parse_dims(const char* str, unsigned long* dims_array, unsigned* dims) {
+    *dims = 0;
+    while (*dims < MAX_DIMS) {
+        char* endptr;
+        if (*str < '0' || *str > '9') return 1;
+        unsigned long size = strtoul(str, &endptr, 10);
+        if (size < 1) return 1;
+        dims_array[(*dims)++] = size;
+        if (*endptr == '\0') return *dims < 2;
+        if (*endptr != ',') return 1;
+        str = endptr + 1;
+    }
+    return 1;
+}
+
 /**
  * parse_args: Parses argc and argv into the structure at args
  *
@@ -149,21 +258,44 @@ static int parse_args(
     ) {
 
     // Setup some defaults
-    args_p->out_file = DEFAULT_OUTFILE;
+    args_p->out_file = NULL; // Depends on --count
     args_p->out_format = DEFAULT_OUT_FORMAT;
-    args_p->seed = (unsigned int) DEFAULT_SEED;
+    args_p->seed = (uint64_t) DEFAULT_SEED;
     args_p->limit = 0; // No limit
-    write_steps_prefix = NULL;
+    args_p->algorithm = NULL; // Depends on --stream
+    args_p->threads = 0;
+    args_p->tile_size = DEFAULT_TILE_SIZE;
+    args_p->stream = 0;
+    args_p->write_steps_prefix = NULL;
+    args_p->trace_path = NULL;
+    args_p->slices_prefix = NULL;
+    args_p->serve_path = NULL;
+    args_p->seeded = 0;
+    args_p->cache_dir = NULL;
+    args_p->cache_size = DEFAULT_CACHE_SIZE;
+    args_p->stats = 0;
+    args_p->solve = 0;
+    args_p->batch_path = NULL;
+    args_p->count = 0;
+    args_p->seed_prefix = NULL;
+    args_p->jobs = 0;
+    args_p->tar_path = NULL;
+    args_p->tar = NULL;
 
     // If any arg is -h, print help and exit
     if (argc  >= 2) {
         for (int i = 0; i < argc; i++) {
             if (strncmp("-h", argv[i], 2) == 0) {
-                printf("%s\n%s", usage,  help);
+                printf("%s\n%s%s%s", usage, help, help_more, help_batch);
                 exit(0);
             } else if (strncmp("--print-valid-formats", argv[i], 21) == 0) {
                 printf("png\n");
                 printf("text\n");
+                printf("bin\n");
+                exit(0);
+            } else if (strncmp("--print-valid-algorithms", argv[i], 25) == 0) {
+                char names[] = MAZE_ALGORITHMS;
+                for (char* name = strtok(names, " "); name; name = strtok(NULL, " ")) printf("%s\n", name);
                 exit(0);
             }
         }
@@ -172,10 +304,25 @@ static int parse_args(
 
     // Parse the other flags, if there are any
     char* endptr;
-    unsigned long size = DEFAULT_SIZE, rows = 0, cols = 0;
+    unsigned long size = DEFAULT_SIZE, rows = 0, cols = 0, depth = 0;
+    // 0 until --dims is given
+    unsigned dims = 0;
+    // NO_CELL until given, as the defaults depend on the size
+    unsigned long solve_from[2] = { NO_CELL, NO_CELL }, solve_to[2] = { NO_CELL, NO_CELL };
     if (argc > 1) {
         for (int i = 1; i < argc; i++) {
-            if (i == argc - 1) {
+            // Flags without arguments
+            if (strncmp(argv[i], "--stream", 9) == 0) {
+                args_p->stream = 1;
+            } else if (strncmp(argv[i], "--stats", 8) == 0) {
+#ifdef MAZE_NO_STATS
+                fprintf(stderr, "Error: --stats isn't available, this was built with MAZE_NO_STATS\n");
+                return 2; // User gave bad values
+#endif
+                args_p->stats = 1;
+            } else if (strncmp(argv[i], "--solve", 8) == 0) {
+                args_p->solve = 1;
+            } else if (i == argc - 1) {
                 fprintf(stderr, "Error: Missing argument for %s.\n", argv[i]);
                 fprintf(stderr, "%s\n", usage);
                 return 2; // User gave bad input
@@ -200,10 +347,34 @@ static int parse_args(
                             "--cols (must be a positive integer)\n", argv[i]);
                     return 2; // User gave bad values
                 }
+            } else if (strncmp(argv[i], "--depth", 8) == 0) {
+                depth = strtoul(argv[++i], &endptr, 10);
+                if (depth < 1 || *endptr != '\0') {
+                    fprintf(stderr, "Error: `%s` is not a valid argument for "
+                            "--depth (must be a positive integer)\n", argv[i]);
+                    return 2; // User gave bad values
+                }
+            } else if (strncmp(argv[i], "--dims", 7) == 0) {
+                if (parse_dims(argv[++i], args_p->dims_array, &dims)) {
+                    fprintf(stderr, "Error: `%s` is not a valid argument for "
+                            "--dims (must be 2 to "STRINGIFY(MAX_DIMS)" positive integers, separated by commas)\n", argv[i]);
+                    return 2; // User gave bad values
+                }
+            } else if (strncmp(argv[i], "--slices", 9) == 0) {
+               args_p->slices_prefix = argv[++i];
             } else if (strncmp(argv[i], "-f", 2) == 0) {
                 args_p->out_file = argv[++i];
+            } else if (strncmp(argv[i], "--seed-prefix", 14) == 0) {
+               args_p->seed_prefix = argv[++i];
             } else if (strncmp(argv[i], "--seed", 6) == 0) {
-               args_p->seed = hash_string((unsigned const char*)argv[++i]);
+               args_p->seed = rng_hash_string(argv[++i]);
+               args_p->seeded = 1;
+            } else if (strncmp(argv[i], "--algorithm", 12) == 0) {
+                args_p->algorithm = find_maze_algorithm(argv[++i]);
+                if (!args_p->algorithm) {
+                    fprintf(stderr, "Error: `%s` isn't a valid algorithm, see --print-valid-algorithms\n", argv[i]);
+                    return 2; // User gave bad values
+                }
             } else if (strncmp(argv[i], "--path-len", 10) == 0) {
                 args_p->limit = strtoul(argv[++i], &endptr, 10);
                 if (*endptr != '\0') {
@@ -211,15 +382,71 @@ static int parse_args(
                             "--limit (must be a positive integer or 0)\n", argv[i]);
                     return 2; // User gave bad values
                 }
+            } else if (strncmp(argv[i], "--threads", 9) == 0) {
+                unsigned long threads = strtoul(argv[++i], &endptr, 10);
+                if (threads < 1 || threads > 1024 || *endptr != '\0') {
+                    fprintf(stderr, "Error: `%s` is not a valid argument for "
+                            "--threads (must be an integer from 1 to 1024)\n", argv[i]);
+                    return 2; // User gave bad values
+                }
+                args_p->threads = (unsigned) threads;
+            } else if (strncmp(argv[i], "--tile-size", 11) == 0) {
+                args_p->tile_size = strtoul(argv[++i], &endptr, 10);
+                if (args_p->tile_size < 1 || *endptr != '\0') {
+                    fprintf(stderr, "Error: `%s` is not a valid argument for "
+                            "--tile-size (must be a positive integer)\n", argv[i]);
+                    return 2; // User gave bad values
+                }
             } else if (strncmp(argv[i], "--format", 9) == 0) {
                args_p->out_format = argv[++i];
                // Verify it's valid
-               if (strstr(VALID_OUT_FORMATS, args_p->out_format) == NULL) {
+               if (!maze_format_valid(args_p->out_format)) {
                     fprintf(stderr, "Error: `%s` isn't a valid output format.\n",
                             args_p->out_format);
+                    return 2; // User gave bad values
                }
+            } else if (strncmp(argv[i], "--serve", 8) == 0) {
+               args_p->serve_path = argv[++i];
+            } else if (strncmp(argv[i], "--cache-dir", 12) == 0) {
+               args_p->cache_dir = argv[++i];
+            } else if (strncmp(argv[i], "--cache-size", 13) == 0) {
+                args_p->cache_size = strtoul(argv[++i], &endptr, 10);
+                if (args_p->cache_size < 1 || *endptr != '\0') {
+                    fprintf(stderr, "Error: `%s` is not a valid argument for "
+                            "--cache-size (must be a positive integer)\n", argv[i]);
+                    return 2; // User gave bad values
+                }
+            } else if (strncmp(argv[i], "--batch", 8) == 0) {
+               args_p->batch_path = argv[++i];
+            } else if (strncmp(argv[i], "--count", 8) == 0) {
+                args_p->count = strtoul(argv[++i], &endptr, 10);
+                if (args_p->count < 1 || *endptr != '\0') {
+                    fprintf(stderr, "Error: `%s` is not a valid argument for "
+                            "--count (must be a positive integer)\n", argv[i]);
+                    return 2; // User gave bad values
+                }
+            } else if (strncmp(argv[i], "--jobs", 7) == 0) {
+                unsigned long jobs = strtoul(argv[++i], &endptr, 10);
+                if (jobs < 1 || jobs > 1024 || *endptr != '\0') {
+                    fprintf(stderr, "Error: `%s` is not a valid argument for "
+                            "--jobs (must be an integer from 1 to 1024)\n", argv[i]);
+                    return 2; // User gave bad values
+                }
+                args_p->jobs = (unsigned) jobs;
+            } else if (strncmp(argv[i], "--tar", 6) == 0) {
+               args_p->tar_path = argv[++i];
             } else if (strncmp(argv[i], "--write-steps", 15) == 0) {
-               write_steps_prefix = (char*) argv[++i];
+               args_p->write_steps_prefix = argv[++i];
+            } else if (strncmp(argv[i], "--trace", 8) == 0) {
+               args_p->trace_path = argv[++i];
+            } else if (strncmp(argv[i], "--solve-from", 13) == 0 || strncmp(argv[i], "--solve-to", 11) == 0) {
+                unsigned long* cell = argv[i][8] == 'f' ? solve_from : solve_to;
+                if (parse_cell(argv[++i], cell)) {
+                    fprintf(stderr, "Error: `%s` is not a valid argument for "
+                            "%s (must be row,col)\n", argv[i], argv[i - 1]);
+                    return 2; // User gave bad values
+                }
+                args_p->solve = 1;
             } else {
                 fprintf(stderr, "Error: `%s` isn't a flag.\n", argv[i]);
                 return 2; // User gave bad values
@@ -227,206 +454,738 @@ static int parse_args(
         }
     }
 
-    // Default rows and cols to size
+    if (!args_p->out_file) args_p->out_file = args_p->count ? DEFAULT_BATCH_PREFIX : DEFAULT_OUTFILE;
+    if (args_p->batch_path && args_p->count) {
+        fprintf(stderr, "Error: --batch can't be combined with --count\n");
+        return 2; // User gave bad values
+    }
+    if (!args_p->count != !args_p->seed_prefix) {
+        fprintf(stderr, "Error: --count and --seed-prefix must be given together\n");
+        return 2; // User gave bad values
+    }
+    if (args_p->count && (args_p->seeded || args_p->write_steps_prefix || args_p->trace_path || args_p->slices_prefix)) {
+        fprintf(stderr, "Error: --count can't be combined with --seed, --write-steps, --trace or --slices\n");
+        return 2; // User gave bad values
+    }
+    int batch = args_p->batch_path || args_p->count;
+    if (args_p->count && !args_p->tar_path && strcmp(args_p->out_file, STDOUT_PATH) == 0) {
+        fprintf(stderr, "Error: --count makes many mazes, so can only write to stdout through --tar "STDOUT_PATH"\n");
+        return 2; // User gave bad values
+    }
+    if (!batch && (args_p->jobs || args_p->tar_path)) {
+        fprintf(stderr, "Error: --jobs and --tar only work with --batch or --count\n");
+        return 2; // User gave bad values
+    }
+    if (batch && args_p->serve_path) {
+        fprintf(stderr, "Error: --serve can't be combined with --batch or --count\n");
+        return 2; // User gave bad values
+    }
+    if (args_p->tar_path && (args_p->stream || args_p->slices_prefix)) {
+        fprintf(stderr, "Error: --tar can't be combined with --stream or --slices\n");
+        return 2; // User gave bad values
+    }
+
+    if (!args_p->algorithm) args_p->algorithm = find_maze_algorithm(args_p->stream ? "eller" : MAZE_DEFAULT_ALGORITHM);
+    int dfs = strcmp(args_p->algorithm->name, "dfs") == 0;
+    if (!dfs && args_p->trace_path) {
+        fprintf(stderr, "Error: --trace only works with --algorithm dfs\n");
+        return 2; // User gave bad values
+    }
+    if (!dfs && args_p->threads && !args_p->algorithm->carve_threads) {
+        fprintf(stderr, "Error: --threads only works with --algorithm dfs or kruskal\n");
+        return 2; // User gave bad values
+    }
+    if (args_p->stream && !args_p->algorithm->new_rows) {
+        fprintf(stderr, "Error: --algorithm %s can't --stream, it doesn't work a row at a time\n", args_p->algorithm->name);
+        return 2; // User gave bad values
+    }
+    if (args_p->threads && (args_p->limit || args_p->write_steps_prefix || args_p->trace_path)) {
+        fprintf(stderr, "Error: --threads can't be combined with --path-len, --write-steps or --trace\n");
+        return 2; // User gave bad values
+    }
+    if (args_p->stream && (args_p->threads || args_p->limit || args_p->write_steps_prefix || args_p->trace_path)) {
+        fprintf(stderr, "Error: --stream can't be combined with --threads, --path-len, --write-steps or --trace\n");
+        return 2; // User gave bad values
+    }
+    if (args_p->trace_path && args_p->write_steps_prefix) {
+        fprintf(stderr, "Error: --trace can't be combined with --write-steps\n");
+        return 2; // User gave bad values
+    }
+    if (args_p->solve && (args_p->stream || strcmp(args_p->out_format, "bin") == 0)) {
+        fprintf(stderr, "Error: --solve can't be combined with --stream or --format bin\n");
+        return 2; // User gave bad values
+    }
+
+    // Default rows and cols to size, unless --dims gave every dimension
     if (rows == 0) rows = size;
     if (cols == 0) cols = size;
+    if (dims) {
+        rows = args_p->dims_array[dims - 2];
+        cols = args_p->dims_array[dims - 1];
+    } else {
+        if (depth) args_p->dims_array[dims++] = depth;
+        args_p->dims_array[dims++] = rows;
+        args_p->dims_array[dims++] = cols;
+    }
+    if (dims > args_p->algorithm->max_dims) {
+        fprintf(stderr, "Error: --algorithm %s can't make mazes of more than %u dimensions\n",
+                args_p->algorithm->name, args_p->algorithm->max_dims);
+        return 2; // User gave bad values
+    }
+    args_p->dims = dims;
     args_p->rows = rows;
     args_p->cols = cols;
 
+    // Every cell needs an index
+    unsigned long cells = 1;
+    for (unsigned d = 0; d < dims; d++) {
+        if (args_p->dims_array[d] > (unsigned long) -1 / cells) {
+            fprintf(stderr, "Error: the maze has too many cells\n");
+            return 2; // User gave bad values
+        }
+        cells *= args_p->dims_array[d];
+    }
+    if (dims > 2 && ((args_p->threads && dfs) || args_p->stream || args_p->write_steps_prefix || args_p->trace_path || args_p->solve)) {
+        fprintf(stderr, "Error: mazes of more than two dimensions can't be made with --threads (except with kruskal), --stream, --write-steps, --trace or --solve\n");
+        return 2; // User gave bad values
+    }
+    if (dims > MAZE_RASTER_MAX_DIMS && strcmp(args_p->out_format, "bin") != 0) {
+        fprintf(stderr, "Error: mazes of more than "STRINGIFY(MAZE_RASTER_MAX_DIMS)" dimensions can only be written with --format bin\n");
+        return 2; // User gave bad values
+    }
+    if (args_p->slices_prefix && (args_p->stream || args_p->solve || strcmp(args_p->out_format, "bin") == 0)) {
+        fprintf(stderr, "Error: --slices can't be combined with --stream, --solve or --format bin\n");
+        return 2; // User gave bad values
+    }
+
+    // Solve from corner to corner by default
+    if (solve_from[0] == NO_CELL) {
+        solve_from[0] = 0;
+        solve_from[1] = 0;
+    }
+    if (solve_to[0] == NO_CELL) {
+        solve_to[0] = rows - 1;
+        solve_to[1] = cols - 1;
+    }
+    if (solve_from[0] >= rows || solve_from[1] >= cols || solve_to[0] >= rows || solve_to[1] >= cols) {
+        fprintf(stderr, "Error: the cells to solve between must be inside the maze\n");
+        return 2; // User gave bad values
+    }
+    for (int i = 0; i < 2; i++) {
+        args_p->solve_from[i] = solve_from[i];
+        args_p->solve_to[i] = solve_to[i];
+    }
+
     return 0;
 }
 
-// Image for printing steps. Shared by all step prints to reduce allocations
-struct img* step_img;
-
 /** cleanup actions to take on normal exit */
 void cleanup(void) {
     free(usage);
+}
 
-    if (step_img) {
-        for (int r = 0; r < step_img->height; r++) free(step_img->rows[r]);
-        free(step_img->rows);
-        free(step_img);
+/**
+ * Open a file for writing, or print an error
+ * `STDOUT_PATH` gives stdout, with a buffer as big as a pipe's, so it can be
+ * piped straight into another program or a socket.
+ */
+static FILE* open_output(const char* path) {
+    if (strcmp(path, STDOUT_PATH) == 0) {
+        static char buffer[1 << 16];
+        setvbuf(stdout, buffer, _IOFBF, sizeof(buffer));
+        return stdout;
     }
+    FILE* file = fopen(path, "wb");
+    if (!file) fprintf(stderr, "Error: couldn't open `%s` for writing\n", path);
+    return file;
+}
+
+/**
+ * Close a file from `open_output()`. Stdout is only flushed.
+ *
+ * Return: 0 if everything was written, nonzero otherwise
+ */
+static int close_output(FILE* file) {
+    if (file == stdout) return fflush(stdout) != 0 || ferror(stdout);
+    return fclose(file) != 0;
+}
+
+/** Open the output file, or print an error */
+static FILE* open_out_file(const struct arguments* args) {
+    return open_output(args->out_file);
 }
 
-/** write the maze as a png */
-void write_maze_png(const struct maze* maze, const struct cell* current, const char* filename) {
-    struct img img;
-    img.height = (int) (2 * maze->dims_array[0] + 1);
-    img.width = (int) (2 * maze->dims_array[1] + 1);
-    img.rows = calloc((size_t)img.height, sizeof(struct pixel*));
-    for (int r = 0; r < img.height; r++) {
-        img.rows[r] = calloc((size_t)img.width, sizeof(struct pixel));
-    }
-
-    unsigned long current_row;
-    unsigned long current_col;
-    if (current) {
-        current_row = current->coords[0] * 2 + 1;
-        current_col = current->coords[1] * 2 + 1;
-    }
-
-    for (unsigned short r = 0; r < maze->dims_array[0]; r++) {
-        for (unsigned short c = 0; c < maze->dims_array[1]; c++) {
-            struct cell* cell = maze->maze[r][c];
-            unsigned long cell_row = cell->coords[0] * 2 + 1;
-            unsigned long cell_col = cell->coords[1] * 2 + 1;
-            if (!cell->visited) continue;
-            img.rows[cell_row][cell_col].red = 255;
-            img.rows[cell_row][cell_col].green = 255;
-            img.rows[cell_row][cell_col].blue = 255;
-            if (current && (2 * r + 1) == (long)current_row && (2 * c + 1) == (long)current_col) {
-                img.rows[cell_row][cell_col].red = 255;
-                img.rows[cell_row][cell_col].green = 0;
-                img.rows[cell_row][cell_col].blue = 0;
+/**
+ * Generate a maze a row at a time and write it out as it's generated, without
+ * ever holding the whole maze
+ *
+ * Return: 0 on success, nonzero on failure
+ */
+static int stream_maze(struct arguments* args, struct rng* rng, struct maze_stats* stats) {
+    FILE* file = open_out_file(args);
+    if (!file) return 1;
+
+    const struct maze_algorithm* algorithm = args->algorithm;
+    void* source = algorithm->new_rows(args->rows, args->cols, rng);
+    // Each row is carved as it's needed, so the carving is taken back out
+    double carved = stats ? stats->seconds[MAZE_PHASE_CARVE] : 0;
+    STATS_PHASE_START(timer);
+    int err = write_maze_rows(file, args->rows, args->cols, algorithm->next_row, source,
+            args->out_format, args->seed, algorithm->id);
+    STATS_PHASE_END(MAZE_PHASE_ENCODE, timer);
+    if (stats) stats->seconds[MAZE_PHASE_ENCODE] -= stats->seconds[MAZE_PHASE_CARVE] - carved;
+    algorithm->rows_deallocate(source);
+
+    STATS_PHASE_START(close_timer);
+    err = close_output(file) || err;
+    STATS_PHASE_END(MAZE_PHASE_WRITE, close_timer);
+    if (err) {
+        fprintf(stderr, "Error: failed to write `%s`\n", args->out_file);
+        return 1;
+    }
+    return 0;
+}
+
+/** Set a pixel of a step frame, noting the change in `delta` if there is one */
+static void set_pixel(char* frame, struct frame_delta* delta, size_t offset, char value) {
+    if (frame[offset] == value) return;
+    frame[offset] = value;
+    if (delta) {
+        delta->offsets[delta->count] = offset;
+        delta->values[delta->count++] = value;
+    }
+}
+
+/**
+ * Paint a cell of a 2d maze into a step frame, along with the passages leading
+ * south and east from it. Unvisited cells are left alone, and the cell at
+ * index `current` is painted as part of the path. That's at most 3 pixels.
+ */
+static void paint_cell(char* frame, struct frame_delta* delta, const struct maze* maze, unsigned long r, unsigned long c, unsigned long current) {
+    unsigned long cols = maze->dims_array[1];
+    size_t width = RASTER_WIDTH(cols);
+    unsigned long index = r * cols + c;
+    if (!maze_visited(maze, index)) return;
+
+    size_t cell = (2 * r + 1) * width + 2 * c + 1;
+    set_pixel(frame, delta, cell, index == current ? PATH : SPACE);
+    if (maze_passage(maze, index, DIR_PLUS(0))) set_pixel(frame, delta, cell + width, SPACE);
+    if (maze_passage(maze, index, DIR_PLUS(1))) set_pixel(frame, delta, cell + 1, SPACE);
+}
+
+/** State for writing step frames, passed to `write_step()` */
+struct step_writer {
+    const char* prefix;
+    // Frame as characters from text-format.h, as of the last step. Each step
+    // only sends the workers what changed in it.
+    char* frame;
+    // Encodes and writes the frames, started on the first step
+    frame_pipeline_t pipeline;
+    // The cell marked in the frame, if any. Only depth first search always
+    // moves to a neighbor, so it has to be unmarked separately.
+    unsigned long marked;
+};
+
+static void write_step(void* ctx, const struct maze* maze, const unsigned long current, const unsigned int step) {
+    struct step_writer* steps = ctx;
+    unsigned long rows = maze->dims_array[0];
+    unsigned long cols = maze->dims_array[1];
+    size_t width = RASTER_WIDTH(cols);
+    size_t height = RASTER_HEIGHT(rows);
+
+    // Init our cache on the first run
+    if (!steps->frame) {
+        steps->frame = malloc(width * height);
+        memset(steps->frame, WALL, width * height);
+
+        // On the first run, generate the whole image
+        for (unsigned long r = 0; r < rows; r++) {
+            for (unsigned long c = 0; c < cols; c++) {
+                paint_cell(steps->frame, NULL, maze, r, c, current);
             }
-            for (struct list_node* path = cell->paths.start; path != NULL; path = path->next) {
-                unsigned long path_row = path->cell->coords[0] * 2 + 1;
-                unsigned long path_col = path->cell->coords[1] * 2 + 1;
-                long row = (long) path_row + ((long)cell_row - (long)path_row) / 2;
-                long col = (long) path_col + ((long)cell_col - (long)path_col) / 2;
-                img.rows[row][col].red = 255;
-                img.rows[row][col].green = 255;
-                img.rows[row][col].blue = 255;
+        }
+
+        // Encode on every core, leaving generation to this thread
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        unsigned workers = cores < 1 ? 1 : cores > 64 ? 64 : (unsigned) cores;
+        steps->pipeline = new_frame_pipeline(steps->prefix, steps->frame, width, height, workers);
+        frame_pipeline_next(steps->pipeline, step);
+        steps->marked = current;
+    } else {
+        if (current == NO_CELL) return;
+        struct frame_delta* delta = frame_pipeline_next(steps->pipeline, step);
+        unsigned long current_row = current / cols;
+        unsigned long current_col = current % cols;
+
+        unsigned long rmin = current_row > 0 ? current_row - 1 : 0;
+        unsigned long cmin = current_col > 0 ? current_col - 1 : 0;
+        unsigned long rmax = current_row + 1 < rows ? current_row + 1 : rows - 1;
+        unsigned long cmax = current_col + 1 < cols ? current_col + 1 : cols - 1;
+
+        // We only have to update anything immediately surrounding the current
+        // cell, and the cell we were on last step
+        if (steps->marked != NO_CELL) paint_cell(steps->frame, delta, maze, steps->marked / cols, steps->marked % cols, current);
+        for (unsigned long r = rmin; r <= rmax; r++) {
+            for (unsigned long c = cmin; c <= cmax; c++) {
+                paint_cell(steps->frame, delta, maze, r, c, current);
             }
         }
+        steps->marked = current;
     }
-    writepng(filename, &img);
+    frame_pipeline_publish(steps->pipeline);
+}
+
+/** Write an already encoded maze to the output file, or the archive */
+static int write_encoded(const struct arguments* args, const char* data, size_t len) {
+    STATS_PHASE_START(timer);
+    if (args->tar) {
+        int failed = tar_writer_add(args->tar, args->out_file, data, len);
+        STATS_PHASE_END(MAZE_PHASE_WRITE, timer);
+        if (failed) fprintf(stderr, "Error: failed to add `%s` to the archive\n", args->out_file);
+        return failed;
+    }
+    FILE* file = open_out_file(args);
+    if (!file) return 1;
+    int failed = fwrite(data, 1, len, file) != len;
+    failed = close_output(file) || failed;
+    STATS_PHASE_END(MAZE_PHASE_WRITE, timer);
+    if (failed) fprintf(stderr, "Error: failed to write `%s`\n", args->out_file);
+    return failed;
+}
 
-    // Free the image
-    for (int r = 0; r < img.height; r++) free(img.rows[r]);
-    free(img.rows);
+/** The file extension for a format */
+static const char* format_extension(const char* format) {
+    if (strcmp(format, "text") == 0) return "txt";
+    return format;
 }
 
-/** write the maze as a plaintext file, using ' ' for paths and '#' for walls */
-void write_maze_text(const struct maze* maze, struct arguments* args) {
-    FILE* file = fopen(args->out_file, "w+");
-
-    int height = (int) (2 * args->rows + 1);
-    int width = (int) (2 * args->cols + 1);
-    char** rows = calloc((size_t)height, sizeof(char*));
-    for (int r = 0; r < height; r++) {
-        rows[r] = calloc((size_t)width, sizeof(char));
-        for (int c = 0; c < width; c++) {
-            // It might be a wall. More on that later.
-            rows[r][c] = '#';
+/**
+ * Write each layer of a maze to its own file, named '<prefix><number>.png' or
+ * '.txt'
+ * Only one layer's row of cells is held at a time.
+ *
+ * Return: 0 on success, nonzero on failure
+ */
+static int write_slices(const char* prefix, const struct maze* maze, const char* format) {
+    const char* extension = format_extension(format);
+    size_t path_len = strlen(prefix) + 32;
+    char* path = malloc(path_len);
+    unsigned long layers = maze_layers(maze);
+
+    int failed = 0;
+    for (unsigned long layer = 0; layer < layers && !failed; layer++) {
+        snprintf(path, path_len, "%s%04lu.%s", prefix, layer, extension);
+        FILE* file = fopen(path, "wb");
+        if (!file) {
+            fprintf(stderr, "Error: couldn't open `%s` for writing\n", path);
+            failed = 1;
+            break;
         }
+        failed = write_maze_layer(file, maze, layer, format);
+        failed = fclose(file) || failed;
+        if (failed) fprintf(stderr, "Error: failed to write `%s`\n", path);
     }
 
-    for (unsigned short r = 0; r < maze->dims_array[0]; r++) {
-        for (unsigned short c = 0; c < maze->dims_array[1]; c++) {
-            struct cell* cell = maze->maze[r][c];
-            unsigned long cell_row = cell->coords[0] * 2 + 1;
-            unsigned long cell_col = cell->coords[1] * 2 + 1;
-            rows[cell_row][cell_col] = ' ';
-            for (struct list_node* path = cell->paths.start; path != NULL; path = path->next) {
-                unsigned long path_row = path->cell->coords[0] * 2 + 1;
-                unsigned long path_col = path->cell->coords[1] * 2 + 1;
-                long row = (long) path_row + ((long)cell_row - (long)path_row) / 2;
-                long col = (long) path_col + ((long)cell_col - (long)path_col) / 2;
-                rows[row][col] = ' ';
+    free(path);
+    return failed;
+}
+
+/**
+ * Generate the maze, going through the cache if there is one
+ * With stats, the maze is encoded in memory before it's written, so encoding
+ * and writing can be timed separately.
+ *
+ * Return: 0 on success, nonzero on failure
+ */
+static int generate_maze(struct arguments* args, struct rng* rng, maze_cache_t cache, struct maze_stats* stats) {
+    // Only tiles change the maze, threads alone don't
+    int tiled = args->threads && !args->algorithm->carve_threads;
+    unsigned algorithm = tiled ? MAZEFILE_ALGORITHM_TILED_DFS : args->algorithm->id;
+    uint64_t key = 0;
+    if (cache) {
+        // Room for every dimension
+        char generator[128 + 21 * MAX_DIMS];
+        if (tiled) {
+            sprintf(generator, "tiled %lu", args->tile_size);
+        } else {
+            strcpy(generator, args->algorithm->name);
+        }
+        if (args->dims > 2) {
+            strcat(generator, " layers");
+            for (unsigned d = 0; d + 2 < args->dims; d++) {
+                sprintf(generator + strlen(generator), "%s%lu", d ? "," : " ", args->dims_array[d]);
             }
         }
+        if (args->solve) {
+            sprintf(generator + strlen(generator), " solved %lu,%lu %lu,%lu",
+                    args->solve_from[0], args->solve_from[1], args->solve_to[0], args->solve_to[1]);
+        }
+        key = maze_cache_key(generator, args->rows, args->cols, args->limit, args->seed, args->out_format);
+
+        char* data;
+        size_t len;
+        STATS_PHASE_START(timer);
+        int missed = maze_cache_get(cache, key, &data, &len);
+        STATS_PHASE_END(MAZE_PHASE_CACHE, timer);
+        if (!missed) {
+            int failed = write_encoded(args, data, len);
+            free(data);
+            return failed;
+        }
     }
 
-    // Actually write out the maze
-    for (int r = 0; r < height; r++) {
-        for (int c = 0; c < width; c++) {
-            fputc(rows[r][c], file);
+    struct step_writer steps = { args->write_steps_prefix, NULL, NULL, NO_CELL };
+    struct maze* maze;
+    if (args->threads && args->algorithm->carve_threads) {
+        maze = alloc_grid(args->dims, args->dims_array);
+        if (maze) args->algorithm->carve_threads(maze, rng, args->threads);
+    } else if (args->threads) {
+        maze = gen_maze_4_tiled(args->rows, args->cols, args->tile_size, args->threads, rng);
+    } else if (args->trace_path) {
+        FILE* trace_file = fopen(args->trace_path, "wb");
+        if (!trace_file) {
+            fprintf(stderr, "Error: couldn't open `%s` for writing\n", args->trace_path);
+            return 1;
         }
-        fputc('\n', file);
+        trace_writer_t trace = new_trace_writer(trace_file, args->seed, algorithm);
+        maze = gen_maze_4(args->rows, args->cols, args->limit, rng, &trace_step, trace);
+        int trace_failed = trace_writer_finish(trace);
+        if (fclose(trace_file) || trace_failed) {
+            fprintf(stderr, "Error: failed to write `%s`\n", args->trace_path);
+            if (maze) clean_maze(maze);
+            return 1;
+        }
+    } else if (steps.prefix == NULL) {
+        maze = gen_maze_with(args->algorithm, args->dims, args->dims_array, args->limit, rng, NULL, NULL);
+    } else {
+        maze = gen_maze_with(args->algorithm, args->dims, args->dims_array, args->limit, rng, &write_step, &steps);
+        if (steps.pipeline && frame_pipeline_finish(steps.pipeline)) {
+            fprintf(stderr, "Error: failed to write some of the `%s` step frames\n", steps.prefix);
+        }
+        free(steps.frame);
+    }
+    if (!maze) {
+        fprintf(stderr, "Error: not enough memory for a maze that big\n");
+        return 1;
     }
 
-    // Free the buffer
-    for (int r = 0; r < height; r++) free(rows[r]);
-    free(rows);
+    struct maze_solution* solution = NULL;
+    if (args->solve) {
+        unsigned long from = cell_index(maze, args->solve_from);
+        unsigned long to = cell_index(maze, args->solve_to);
+        solution = solve_maze(maze, from, to);
+        // Only possible if --path-len stopped generation early
+        if (!solution) {
+            fprintf(stderr, "Error: there's no path between the cells to solve between\n");
+            clean_maze(maze);
+            return 1;
+        }
+    }
+
+    int failed;
+    if (args->slices_prefix) {
+        STATS_PHASE_START(timer);
+        failed = write_slices(args->slices_prefix, maze, args->out_format);
+        STATS_PHASE_END(MAZE_PHASE_ENCODE, timer);
+        if (solution) solution_deallocate(solution);
+        clean_maze(maze);
+        return failed;
+    }
+    if (cache || stats || args->tar) {
+        // Encode in memory, so the same bytes can go to the file and the cache
+        char* data;
+        size_t len;
+        STATS_PHASE_START(timer);
+        if (solution) {
+            failed = encode_solved_maze(maze, solution, args->out_format, &data, &len);
+        } else {
+            failed = encode_maze(maze, args->out_format, args->seed, algorithm, &data, &len);
+        }
+        STATS_PHASE_END(MAZE_PHASE_ENCODE, timer);
+        if (solution) solution_deallocate(solution);
+        clean_maze(maze);
+        if (failed) {
+            fprintf(stderr, "Error: failed to write `%s`\n", args->out_file);
+            return 1;
+        }
+        if (cache) {
+            STATS_PHASE_START(cache_timer);
+            maze_cache_put(cache, key, data, len);
+            STATS_PHASE_END(MAZE_PHASE_CACHE, cache_timer);
+        }
+        failed = write_encoded(args, data, len);
+        free(data);
+        return failed;
+    }
+
+    FILE* file = open_out_file(args);
+    if (!file) {
+        if (solution) solution_deallocate(solution);
+        clean_maze(maze);
+        return 1;
+    }
+    if (solution) {
+        failed = write_solved_maze(file, maze, solution, args->out_format);
+        solution_deallocate(solution);
+    } else {
+        failed = write_maze(file, maze, args->out_format, args->seed, algorithm);
+    }
+    failed = close_output(file) || failed;
+    clean_maze(maze);
+
+    if (failed) {
+        fprintf(stderr, "Error: failed to write `%s`\n", args->out_file);
+        return 1;
+    }
+    return 0;
 }
 
-void write_step(const struct maze* maze, const struct cell* current, const unsigned int step) {
-    unsigned long current_row;
-    unsigned long current_col;
-    if (current) {
-        current_row = current->coords[0] * 2 + 1;
-        current_col = current->coords[1] * 2 + 1;
+/** Flags that apply to a whole batch, so can't be given for a single maze */
+static const char* batch_flags[] = {
+    "--batch", "--count", "--seed-prefix", "--jobs", "--tar", "--serve", "--cache-dir", "--cache-size", "--stats", NULL,
+};
+
+/**
+ * Read a batch file into the arguments of each of its mazes
+ * Each line's flags are parsed after the command line's, so they override it.
+ * The arguments point into `text`, which must be freed after them.
+ *
+ * Return: 0 on success, nonzero on failure
+ */
+static int read_batch(const struct arguments* args, const int argc, const char** argv,
+        struct arguments** jobs_out, unsigned long* count_out, char** text_out) {
+    FILE* file = fopen(args->batch_path, "rb");
+    if (!file) {
+        fprintf(stderr, "Error: couldn't open `%s` for reading\n", args->batch_path);
+        return 1;
     }
+    size_t len = 0, cap = 4096;
+    char* text = malloc(cap);
+    for (size_t got; (got = fread(text + len, 1, cap - len - 1, file)) > 0;) {
+        len += got;
+        if (len + 1 == cap) text = realloc(text, cap *= 2);
+    }
+    int failed = ferror(file);
+    fclose(file);
+    if (failed) {
+        fprintf(stderr, "Error: failed to read `%s`\n", args->batch_path);
+        free(text);
+        return 1;
+    }
+    text[len] = '\0';
 
-    // Init our cache on the first run
-    if (!step_img) {
-        step_img = calloc(1, sizeof(struct img));
-        step_img->height = (int) (2 * maze->dims_array[0] + 1);
-        step_img->width = (int) (2 * maze->dims_array[1] + 1);
-        step_img->rows = calloc((size_t)step_img->height, sizeof(struct pixel*));
-        for (int r = 0; r < step_img->height; r++) {
-            step_img->rows[r] = calloc((size_t)step_img->width, sizeof(struct pixel));
+    // Every other character of a line could start a flag
+    const char** line_argv = malloc((size_t) argc * sizeof(char*) + (len / 2 + 1) * sizeof(char*));
+    memcpy(line_argv, argv, (size_t) argc * sizeof(char*));
+    unsigned long count = 0, cap_jobs = 64, line_num = 0;
+    struct arguments* jobs = malloc(cap_jobs * sizeof(struct arguments));
+
+    for (char* line = text; line && !failed; ) {
+        char* end = strchr(line, '\n');
+        if (end) *end = '\0';
+        line_num++;
+
+        int line_argc = argc;
+        for (char* token = line; *token; ) {
+            token += strspn(token, " \t\r");
+            if (!*token || (line_argc == argc && *token == '#')) break;
+            line_argv[line_argc++] = token;
+            token += strcspn(token, " \t\r");
+            if (*token) *token++ = '\0';
         }
+        line = end ? end + 1 : NULL;
+        if (line_argc == argc) continue;
 
-        // On the first run, generate the whole image
-        for (unsigned short r = 0; r < maze->dims_array[0]; r++) {
-            for (unsigned short c = 0; c < maze->dims_array[1]; c++) {
-                struct cell* cell = maze->maze[r][c];
-                if (!cell->visited) continue;
-                unsigned long cell_row = cell->coords[0] * 2 + 1;
-                unsigned long cell_col = cell->coords[1] * 2 + 1;
-                step_img->rows[cell_row][cell_col].red = 255;
-                step_img->rows[cell_row][cell_col].green = 255;
-                step_img->rows[cell_row][cell_col].blue = 255;
-                if (current && (2 * r + 1) == (long)current_row && (2 * c + 1) == (long)current_col) {
-                    step_img->rows[cell_row][cell_col].red = 255;
-                    step_img->rows[cell_row][cell_col].green = 0;
-                    step_img->rows[cell_row][cell_col].blue = 0;
-                }
-                for (struct list_node* path = cell->paths.start; path != NULL; path = path->next) {
-                    unsigned long path_row = path->cell->coords[0] * 2 + 1;
-                    unsigned long path_col = path->cell->coords[1] * 2 + 1;
-                    long row = (long) path_row + ((long)cell_row - (long)path_row) / 2;
-                    long col = (long) path_col + ((long)cell_col - (long)path_col) / 2;
-                    step_img->rows[row][col].red = 255;
-                    step_img->rows[row][col].green = 255;
-                    step_img->rows[row][col].blue = 255;
+        for (int i = argc; i < line_argc && !failed; i++) {
+            for (const char** flag = batch_flags; *flag && !failed; flag++) {
+                if (strcmp(line_argv[i], *flag) == 0) {
+                    fprintf(stderr, "Error: %s only goes on the command line\n", *flag);
+                    failed = 1;
                 }
             }
         }
-    } else {
-        if (!current) return;
-        unsigned long rows = maze->dims_array[0];
-        unsigned long cols = maze->dims_array[1];
+        if (count == cap_jobs) jobs = realloc(jobs, (cap_jobs *= 2) * sizeof(struct arguments));
+        struct arguments* job = &jobs[count];
+        failed = failed || parse_args(job, line_argc, line_argv);
+        if (!failed && args->tar_path && (job->stream || job->slices_prefix)) {
+            fprintf(stderr, "Error: --tar can't be combined with --stream or --slices\n");
+            failed = 1;
+        }
+        if (!failed && !args->tar_path && strcmp(job->out_file, STDOUT_PATH) == 0) {
+            fprintf(stderr, "Error: a batch makes many mazes, so can only write to stdout through --tar "STDOUT_PATH"\n");
+            failed = 1;
+        }
+        if (failed) {
+            fprintf(stderr, "Error: on line %lu of `%s`\n", line_num, args->batch_path);
+        } else {
+            if (!job->seeded) job->seed += line_num;
+            count++;
+        }
+    }
+    free(line_argv);
 
-        unsigned short rmin = (unsigned short)(current_row + (current_row > 0)? -1 : 0);
-        unsigned short cmin = (unsigned short)(current_col + (current_col > 0)? -1 : 0);
-        unsigned short rmax = (unsigned short)(current_row + (current_row + 1 < rows)? 1 : rows - 1);
-        unsigned short cmax = (unsigned short)(current_col + (current_col + 1 < cols)? 1 : cols - 1);
+    if (failed) {
+        free(jobs);
+        free(text);
+        return 2; // User gave bad values
+    }
+    *jobs_out = jobs;
+    *count_out = count;
+    *text_out = text;
+    return 0;
+}
 
-        // We only have to update anything immediately surrounding the current
-        for (unsigned short r = rmin; r <= rmax; r++) {
-            for (unsigned short c = cmin; c <= cmax; c++) {
-                struct cell* cell = maze->maze[r][c];
-                unsigned long cell_row = cell->coords[0] * 2 + 1;
-                unsigned long cell_col = cell->coords[1] * 2 + 1;
-                if (!cell->visited) continue;
-                step_img->rows[cell_row][cell_col].red = 255;
-                step_img->rows[cell_row][cell_col].green = 255;
-                step_img->rows[cell_row][cell_col].blue = 255;
-                if (current && (2 * r + 1) == (long)current_row && (2 * c + 1) == (long)current_col) {
-                    step_img->rows[cell_row][cell_col].red = 255;
-                    step_img->rows[cell_row][cell_col].green = 0;
-                    step_img->rows[cell_row][cell_col].blue = 0;
-                }
-                for (struct list_node* path = cell->paths.start; path != NULL; path = path->next) {
-                    unsigned long path_row = path->cell->coords[0] * 2 + 1;
-                    unsigned long path_col = path->cell->coords[1] * 2 + 1;
-                    long row = (long) path_row + ((long)cell_row - (long)path_row) / 2;
-                    long col = (long) path_col + ((long)cell_col - (long)path_col) / 2;
-                    step_img->rows[row][col].red = 255;
-                    step_img->rows[row][col].green = 255;
-                    step_img->rows[row][col].blue = 255;
-                }
-            }
+/* Mazes shared out between the workers of a batch */
+struct batch {
+    /** The command line's arguments */
+    const struct arguments* args;
+    /** The arguments of each maze from --batch, or NULL for --count */
+    const struct arguments* jobs;
+    unsigned long count;
+    maze_cache_t cache;
+    tar_writer_t tar;
+    pthread_mutex_t lock; // protects everything below
+    /** The next maze nobody has picked up yet */
+    unsigned long next;
+    unsigned long failed;
+    /** Every worker's stats, added up */
+    struct maze_stats stats;
+};
+
+// Thread entry point: make mazes until there are none left
+static void* run_batch_worker(void* arg) {
+    struct batch* batch = arg;
+    const struct arguments* base = batch->args;
+    struct maze_stats stats;
+    if (base->stats) maze_stats_attach(&stats);
+
+    // Room for --count's numbers
+    char* seed = NULL;
+    char* path = NULL;
+    if (!batch->jobs) {
+        seed = malloc(strlen(base->seed_prefix) + 21);
+        path = malloc(strlen(base->out_file) + 26);
+    }
+
+    unsigned long failed = 0;
+    while (1) {
+        pthread_mutex_lock(&batch->lock);
+        unsigned long i = batch->next++;
+        pthread_mutex_unlock(&batch->lock);
+        if (i >= batch->count) break;
+
+        struct arguments args;
+        if (batch->jobs) {
+            args = batch->jobs[i];
+        } else {
+            args = *base;
+            sprintf(seed, "%s%lu", base->seed_prefix, i);
+            args.seed = rng_hash_string(seed);
+            args.seeded = 1;
+            sprintf(path, "%s%lu.%s", base->out_file, i, format_extension(base->out_format));
+            args.out_file = path;
+        }
+        args.tar = batch->tar;
+
+        struct rng rng;
+        rng_seed(&rng, args.seed);
+        struct maze_stats* maze_stats = base->stats ? &stats : NULL;
+        if (args.stream) {
+            failed += stream_maze(&args, &rng, maze_stats) != 0;
+        } else {
+            // Cached like a single maze would be
+            int cacheable = args.seeded && !args.write_steps_prefix && !args.trace_path && !args.slices_prefix;
+            failed += generate_maze(&args, &rng, cacheable ? batch->cache : NULL, maze_stats) != 0;
         }
     }
-    char out_file[40];
-    sprintf(out_file, "%s%04d.png", write_steps_prefix, step);
-    writepng(out_file, step_img);
+    free(seed);
+    free(path);
+
+    if (base->stats) maze_stats_attach(NULL);
+    pthread_mutex_lock(&batch->lock);
+    batch->failed += failed;
+    if (base->stats) maze_stats_add(&batch->stats, &stats);
+    pthread_mutex_unlock(&batch->lock);
+    return NULL;
+}
+
+/**
+ * Make the mazes of --batch or --count, on a pool of threads, and print how
+ * fast they were made
+ *
+ * Return: 0 if every maze was made, nonzero otherwise
+ */
+static int run_batch(const struct arguments* args, const int argc, const char** argv, maze_cache_t cache) {
+    struct batch batch;
+    batch.args = args;
+    batch.jobs = NULL;
+    batch.count = args->count;
+    batch.cache = cache;
+    batch.tar = NULL;
+    batch.next = 0;
+    batch.failed = 0;
+    memset(&batch.stats, 0, sizeof(struct maze_stats));
+
+    struct arguments* jobs = NULL;
+    char* text = NULL;
+    if (args->batch_path) {
+        int err = read_batch(args, argc, argv, &jobs, &batch.count, &text);
+        if (err) return err;
+        batch.jobs = jobs;
+    }
+
+    FILE* tar_file = NULL;
+    if (args->tar_path) {
+        tar_file = open_output(args->tar_path);
+        if (!tar_file) {
+            free(jobs);
+            free(text);
+            return 1;
+        }
+        batch.tar = new_tar_writer(tar_file);
+    }
+
+    unsigned workers = args->jobs;
+    if (!workers) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = cores < 1 ? 1 : cores > 64 ? 64 : (unsigned) cores;
+    }
+    if (workers > batch.count) workers = batch.count ? (unsigned) batch.count : 1;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pthread_mutex_init(&batch.lock, NULL);
+    pthread_t* threads = malloc(workers * sizeof(pthread_t));
+    unsigned started = 0;
+    for (; started < workers; started++) {
+        if (pthread_create(&threads[started], NULL, run_batch_worker, &batch) != 0) break;
+    }
+    // If no threads could be started, make them all on this one
+    if (started == 0) run_batch_worker(&batch);
+    for (unsigned i = 0; i < started; i++) pthread_join(threads[i], NULL);
+    free(threads);
+    pthread_mutex_destroy(&batch.lock);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    int failed = batch.failed > 0;
+    if (batch.tar) {
+        int tar_failed = tar_writer_finish(batch.tar);
+        if (close_output(tar_file) || tar_failed) {
+            fprintf(stderr, "Error: failed to write `%s`\n", args->tar_path);
+            failed = 1;
+        }
+    }
+
+    double seconds = (double) (end.tv_sec - start.tv_sec) + (double) (end.tv_nsec - start.tv_nsec) / 1e9;
+    unsigned long made = batch.count - batch.failed;
+    fprintf(stderr, "Made %lu mazes in %.3fs on %u threads, %.1f mazes/s\n",
+            made, seconds, started ? started : 1, seconds > 0 ? (double) made / seconds : 0.0);
+    if (batch.failed) fprintf(stderr, "Error: %lu of %lu mazes failed\n", batch.failed, batch.count);
+    if (args->stats) maze_stats_print(stderr, &batch.stats);
+
+    free(jobs);
+    free(text);
+    return failed;
 }
 
 int main(const int argc, const char** argv) {
@@ -437,21 +1196,39 @@ int main(const int argc, const char** argv) {
     struct arguments args;
     int err = parse_args(&args, argc, argv);
     if (err) return err;
-    srand(args.seed);
 
-    struct maze* maze;
-    if (write_steps_prefix == NULL) {
-        maze = gen_maze_4(args.rows, args.cols, args.limit, NULL);
-    } else {
-        maze = gen_maze_4(args.rows, args.cols, args.limit, &write_step);
+    // Only seeded mazes are worth caching. The server decides per request.
+    maze_cache_t cache = NULL;
+    int batch = args.batch_path || args.count;
+    int cacheable = args.serve_path || batch || (args.seeded && !args.stream && !args.write_steps_prefix && !args.trace_path && !args.slices_prefix);
+    if (args.cache_dir && cacheable) {
+        cache = new_maze_cache(args.cache_dir, (uint64_t) args.cache_size << 20);
+        if (!cache) fprintf(stderr, "Warning: can't use `%s` as a cache, not caching\n", args.cache_dir);
+    }
+
+    if (args.serve_path) return serve(args.serve_path, cache);
+    if (batch) {
+        err = run_batch(&args, argc, argv, cache);
+        if (cache) maze_cache_deallocate(cache);
+        return err;
     }
 
-    if (strcmp("png", args.out_format) == 0)
-        write_maze_png(maze, NULL, args.out_file);
-    else if (strcmp("text", args.out_format) == 0)
-        write_maze_text(maze, &args);
+    struct rng rng;
+    rng_seed(&rng, args.seed);
 
-    clean_maze(maze);
+    struct maze_stats stats;
+    if (args.stats) maze_stats_attach(&stats);
 
-    return 0;
+    if (args.stream) {
+        err = stream_maze(&args, &rng, args.stats ? &stats : NULL);
+    } else {
+        err = generate_maze(&args, &rng, cache, args.stats ? &stats : NULL);
+    }
+
+    if (args.stats) {
+        maze_stats_attach(NULL);
+        maze_stats_print(stderr, &stats);
+    }
+    if (cache) maze_cache_deallocate(cache);
+    return err;
 }
@@ -1,11 +1,14 @@
 """ A web interface for generating mazes """
 
+import functools
 import os
 import subprocess
 from typing import Any, Optional, Union
 
-from flask import Flask, render_template, send_from_directory, send_file, request
+from flask import Flask, render_template, send_from_directory, request
 
+from .cache import LRUCache
+from .client import InProcessClient, MazeClient, MazeServerError
 from .link import LinkHeader, Link, LinkParam
 
 Headers = dict[str, str]
@@ -15,6 +18,7 @@ Response = Union[tuple[str, int], tuple[Any, int, Headers]]
 mimetypes: dict[str, str] = {
     'png': 'image/png',
     'text': 'text/plain',
+    'bin': 'application/octet-stream',
 }
 
 APP = Flask(__name__)
@@ -27,6 +31,25 @@ else:
 
 APP.secret_key = APP.config['SECRET_KEY']
 
+CLIENT: Union[MazeClient, InProcessClient]
+if APP.config['BACKEND'] == 'extension':
+    CLIENT = InProcessClient(APP.config['CACHE_DIR'])
+else:
+    CLIENT = MazeClient(APP.config['SOCKET_PATH'])
+
+# Seeded mazes never change within a build, so popular ones are kept around
+CACHE = LRUCache(int(APP.config['CACHE_MEMORY_BYTES']))
+
+@functools.cache
+def valid_out_formats() -> frozenset[str]:
+    """ The formats the maze server can produce. These can't change while it runs """
+    return frozenset(CLIENT.formats())
+
+@functools.cache
+def valid_algorithms() -> frozenset[str]:
+    """ The algorithms the maze server can generate with """
+    return frozenset(CLIENT.algorithms())
+
 @APP.route('/', methods=['GET'])
 @APP.route('/<out_format>', methods=['GET'])
 def _png(out_format: str = 'png') -> Response:
@@ -37,6 +60,8 @@ def _png(out_format: str = 'png') -> Response:
       - cols: the number of columns
       - seed: plaintext seed to use
       - path_len: the maximum length of the path, defaulting to no limit (0)
+      - algorithm: how to generate the maze, defaulting to dfs. binary-tree
+        and sidewinder are several times faster, for very large mazes
 
     Path params:
       - out_format: the format to return
@@ -46,39 +71,28 @@ def _png(out_format: str = 'png') -> Response:
     cols = request.args.get('cols', APP.config['DEFAULT_SIZE'])
     seed = request.args.get('seed', None)
     path_len = request.args.get('path_len', 0)
+    algorithm = request.args.get('algorithm', 'dfs')
 
-    valid_out_formats = set(subprocess.check_output([
-        APP.config['EXEC_PATH'],
-        '--print-valid-formats',
-        ]
-    ).decode('utf8').split())
-    if out_format not in valid_out_formats:
-        return f'out_format {out_format} must be one of {valid_out_formats}', 404
+    try:
+        rows, cols, path_len = int(rows), int(cols), int(path_len)
+    except ValueError:
+        return 'rows, cols and path_len must be integers', 400
 
     try:
-        print([
-                APP.config['EXEC_PATH'],
-                '--rows', rows,
-                '--cols', cols,
-                '--path-len', path_len,
-                '-f', APP.config['OUT_PATH'],
-                '--format', out_format,
-            ] + (['--seed', seed] if seed else []))
-
-        subprocess.run([
-                APP.config['EXEC_PATH'],
-                '--rows', str(rows),
-                '--cols', str(cols),
-                '--path-len', str(path_len),
-                '-f', APP.config['OUT_PATH'],
-                '--format', out_format,
-            ] + (['--seed', seed] if seed else []),
-            check=True,
-            capture_output=True,
-        )
-    except subprocess.CalledProcessError as err:
-        # uh so it broke and we should handle that, but that can happen later
-        return f'something went wrong, sorry ({err.returncode})\n\n{err.stderr}', 500
+        if out_format not in valid_out_formats():
+            return f'out_format {out_format} must be one of {set(valid_out_formats())}', 404
+        if algorithm not in valid_algorithms():
+            return f'algorithm {algorithm} must be one of {set(valid_algorithms())}', 400
+        key = (rows, cols, path_len, out_format, seed, algorithm)
+        maze = CACHE.get(key) if seed else None
+        if maze is None:
+            maze = CLIENT.maze(rows, cols, path_len, out_format, seed, algorithm)
+            if seed:
+                CACHE.put(key, maze)
+    except MazeServerError as err:
+        return f'bad request: {err}', 400
+    except OSError as err:
+        return f'something went wrong, sorry ({err})', 500
 
     commit_hash = get_commit()
     if commit_hash:
@@ -104,11 +118,9 @@ def _png(out_format: str = 'png') -> Response:
             )),
         }
 
-    return send_file(
-        APP.config['OUT_PATH'],
-        mimetype=mimetypes.get(out_format, 'application/octet-stream'),
-        max_age=(3600 if seed else 0),
-    ), 200, headers
+    headers['Content-Type'] = mimetypes.get(out_format, 'application/octet-stream')
+    headers['Cache-Control'] = 'public, max-age=3600' if seed else 'no-cache'
+    return maze, 200, headers
 
 
 @APP.route('/_version', methods=['GET'])
@@ -140,8 +152,9 @@ def version() -> Response:
         'Content-Type': 'text/plain',
     }
 
+@functools.cache
 def get_commit() -> Optional[str]:
-    """ Attempt to discover the commit sha  """
+    """ Attempt to discover the commit sha. It doesn't change while we run  """
     try:
         return subprocess.check_output(['git', 'rev-parse', '--short', 'HEAD']) \
                                 .strip() \
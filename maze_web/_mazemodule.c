@@ -0,0 +1,192 @@
+/*
+ * maze_web._maze, generating mazes in process
+ *
+ * Built by `make python` from libmaze. Generation runs without the GIL, so
+ * several threads can generate at once.
+ */
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "algorithms.h"
+#include "cache.h"
+#include "generator.h"
+#include "maze_writer.h"
+
+/* _maze.Cache, wrapping a maze_cache_t */
+typedef struct {
+    PyObject_HEAD
+    maze_cache_t cache;
+} CacheObject;
+
+PyDoc_STRVAR(cache_doc,
+"Cache(dir, max_bytes=256 MiB)\n"
+"\n"
+"An on-disk cache of seeded mazes, shared with `maze --cache-dir`.");
+
+static int cache_init(CacheObject* self, PyObject* args, PyObject* kwargs) {
+    static char* keywords[] = {(char*) "dir", (char*) "max_bytes", NULL};
+    PyObject* dir;
+    unsigned long long max_bytes = MAZE_CACHE_DEFAULT_SIZE;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O&|K", keywords,
+                PyUnicode_FSConverter, &dir, &max_bytes)) {
+        return -1;
+    }
+    if (self->cache) maze_cache_deallocate(self->cache);
+    self->cache = new_maze_cache(PyBytes_AS_STRING(dir), max_bytes);
+    if (!self->cache) {
+        PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, dir);
+        Py_DECREF(dir);
+        return -1;
+    }
+    Py_DECREF(dir);
+    return 0;
+}
+
+static void cache_dealloc(CacheObject* self) {
+    if (self->cache) maze_cache_deallocate(self->cache);
+    Py_TYPE(self)->tp_free((PyObject*) self);
+}
+
+static PyTypeObject CacheType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "maze_web._maze.Cache",
+    .tp_basicsize = sizeof(CacheObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_doc = cache_doc,
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc) cache_init,
+    .tp_dealloc = (destructor) cache_dealloc,
+};
+
+PyDoc_STRVAR(generate_doc,
+"generate(rows, cols, seed=None, path_len=0, fmt='png', cache=None, algorithm='dfs') -> bytes\n"
+"\n"
+"Generate a maze and return it encoded as `fmt`. `seed` is hashed the same way\n"
+"as `maze --seed`, so the same arguments give the same bytes as the binary.\n"
+"Without a seed the current time is used. Seeded mazes are looked up in and\n"
+"stored to `cache`, a `Cache`, if it's given. `algorithm` is one of\n"
+"`algorithms()`.");
+
+static PyObject* generate(PyObject* self, PyObject* args, PyObject* kwargs) {
+    static char* keywords[] = {(char*) "rows", (char*) "cols", (char*) "seed", (char*) "path_len", (char*) "fmt", (char*) "cache",
+        (char*) "algorithm", NULL};
+    // Signed, so negative sizes are errors rather than wrapping around
+    Py_ssize_t rows, cols, limit = 0;
+    const char* seed_str = NULL;
+    const char* format = "png";
+    PyObject* cache_obj = Py_None;
+    const char* algorithm_name = MAZE_DEFAULT_ALGORITHM;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "nn|znsOs", keywords,
+                &rows, &cols, &seed_str, &limit, &format, &cache_obj, &algorithm_name)) {
+        return NULL;
+    }
+    if (rows < 1 || cols < 1) {
+        PyErr_SetString(PyExc_ValueError, "rows and cols must be positive");
+        return NULL;
+    }
+    if (limit < 0) {
+        PyErr_SetString(PyExc_ValueError, "path_len must not be negative");
+        return NULL;
+    }
+    unsigned long dims_array[] = { (unsigned long) rows, (unsigned long) cols }, cells;
+    if (maze_cell_count(2, dims_array, &cells) || cells > MAZE_SERVE_MAX_CELLS) {
+        PyErr_Format(PyExc_ValueError, "rows * cols must be at most %lu", MAZE_SERVE_MAX_CELLS);
+        return NULL;
+    }
+    if (!maze_format_valid(format)) {
+        PyErr_Format(PyExc_ValueError, "fmt must be one of: %s", MAZE_FORMATS);
+        return NULL;
+    }
+    const struct maze_algorithm* algorithm = find_maze_algorithm(algorithm_name);
+    if (!algorithm) {
+        PyErr_Format(PyExc_ValueError, "algorithm must be one of: %s", MAZE_ALGORITHMS);
+        return NULL;
+    }
+
+    maze_cache_t cache = NULL;
+    if (cache_obj != Py_None) {
+        if (!PyObject_TypeCheck(cache_obj, &CacheType)) {
+            PyErr_SetString(PyExc_TypeError, "cache must be a Cache or None");
+            return NULL;
+        }
+        cache = ((CacheObject*) cache_obj)->cache;
+    }
+    char* out;
+    size_t len;
+    int err;
+
+    // Nothing below touches Python objects. seed_str, format and the cache
+    // belong to the argument objects, which the caller keeps alive.
+    Py_BEGIN_ALLOW_THREADS
+    err = cached_maze(cache, algorithm, dims_array[0], dims_array[1], (unsigned long) limit, seed_str, format, &out, &len);
+    Py_END_ALLOW_THREADS
+
+    if (err == MAZE_CACHED_ERR_MEMORY) return PyErr_NoMemory();
+    if (err) {
+        PyErr_SetString(PyExc_RuntimeError, "failed to encode maze");
+        return NULL;
+    }
+    PyObject* bytes = PyBytes_FromStringAndSize(out, (Py_ssize_t) len);
+    free(out);
+    return bytes;
+}
+
+PyDoc_STRVAR(formats_doc,
+"formats() -> tuple[str, ...]\n"
+"\n"
+"The formats `generate()` accepts.");
+
+// Split a space separated list into a tuple
+static PyObject* split_names(const char* names_str) {
+    PyObject* names = PyUnicode_FromString(names_str);
+    if (!names) return NULL;
+    PyObject* list = PyUnicode_Split(names, NULL, -1);
+    Py_DECREF(names);
+    if (!list) return NULL;
+    PyObject* tuple = PyList_AsTuple(list);
+    Py_DECREF(list);
+    return tuple;
+}
+
+static PyObject* formats(PyObject* self, PyObject* unused) {
+    return split_names(MAZE_FORMATS);
+}
+
+PyDoc_STRVAR(algorithms_doc,
+"algorithms() -> tuple[str, ...]\n"
+"\n"
+"The algorithms `generate()` accepts. binary-tree and sidewinder are by far\n"
+"the fastest, for very large mazes.");
+
+static PyObject* algorithms(PyObject* self, PyObject* unused) {
+    return split_names(MAZE_ALGORITHMS);
+}
+
+static PyMethodDef maze_methods[] = {
+    {"generate", (PyCFunction)(void(*)(void)) generate, METH_VARARGS | METH_KEYWORDS, generate_doc},
+    {"formats", formats, METH_NOARGS, formats_doc},
+    {"algorithms", algorithms, METH_NOARGS, algorithms_doc},
+    {NULL, NULL, 0, NULL},
+};
+
+static struct PyModuleDef maze_module = {
+    PyModuleDef_HEAD_INIT,
+    .m_name = "_maze",
+    .m_doc = "Maze generation, in process",
+    .m_size = -1,
+    .m_methods = maze_methods,
+};
+
+PyMODINIT_FUNC PyInit__maze(void) {
+    if (PyType_Ready(&CacheType) < 0) return NULL;
+    PyObject* module = PyModule_Create(&maze_module);
+    if (!module) return NULL;
+
+    Py_INCREF(&CacheType);
+    if (PyModule_AddObject(module, "Cache", (PyObject*) &CacheType) < 0) {
+        Py_DECREF(&CacheType);
+        Py_DECREF(module);
+        return NULL;
+    }
+    return module;
+}
@@ -0,0 +1,119 @@
+""" Clients for generating mazes, via the maze server or in process """
+
+import socket
+import threading
+from typing import Optional
+
+
+class MazeServerError(Exception):
+    """ The request was rejected, e.g. for bad parameters """
+
+
+class MazeClient:
+    """ Talks to a maze server over its Unix socket
+
+    Each thread keeps its own connection open between requests, so a request
+    costs a round trip on an existing socket rather than a connect.
+    """
+    socket_path: str
+
+    def __init__(self, socket_path: str) -> None:
+        self.socket_path = socket_path
+        self._local = threading.local()
+
+    def _connection(self):
+        conn = getattr(self._local, 'conn', None)
+        if conn is None:
+            sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+            sock.connect(self.socket_path)
+            conn = sock.makefile('rwb')
+            sock.close() # the file keeps the socket open
+            self._local.conn = conn
+        return conn
+
+    def _drop_connection(self) -> None:
+        conn = getattr(self._local, 'conn', None)
+        self._local.conn = None
+        if conn is not None:
+            try:
+                conn.close()
+            except OSError:
+                pass
+
+    def _request(self, line: str) -> bytes:
+        # A kept alive connection may have been closed by a server restart, so
+        # retry once on a fresh one
+        for attempt in range(2):
+            try:
+                conn = self._connection()
+                conn.write(line.encode('utf8') + b'\n')
+                conn.flush()
+                status, _, rest = conn.readline().decode('utf8').rstrip('\n').partition(' ')
+                if status == 'ok':
+                    length = int(rest)
+                    body = conn.read(length)
+                    if len(body) != length:
+                        raise ConnectionError('maze server closed the connection')
+                    return body
+                if status == 'error':
+                    raise MazeServerError(rest)
+                raise ConnectionError('maze server closed the connection')
+            except (OSError, ValueError):
+                self._drop_connection()
+                if attempt:
+                    raise
+        raise AssertionError('unreachable')
+
+    def formats(self) -> set[str]:
+        """ The valid output formats """
+        return set(self._request('formats').decode('utf8').split())
+
+    def algorithms(self) -> set[str]:
+        """ The valid generation algorithms """
+        return set(self._request('algorithms').decode('utf8').split())
+
+    # pylint: disable=too-many-arguments
+    def maze(self, rows: int, cols: int, path_len: int, out_format: str,
+             seed: Optional[str] = None, algorithm: str = 'dfs') -> bytes:
+        """ Generate a maze, returning it encoded as `out_format` """
+        if seed is not None and ('\n' in seed or '\0' in seed):
+            raise MazeServerError('seed may not contain newlines or nul bytes')
+        if ' ' in algorithm or '\n' in algorithm:
+            raise MazeServerError('invalid algorithm')
+        line = f'generate {algorithm} {rows} {cols} {path_len} {out_format}'
+        if seed:
+            line += f' {seed}'
+        return self._request(line)
+
+
+class InProcessClient:
+    """ Generates mazes in this process, with the extension from `make python`
+
+    Has the same interface as `MazeClient`. Generation releases the GIL, so
+    threads don't wait on each other.
+    """
+
+    def __init__(self, cache_dir: Optional[str] = None) -> None:
+        # Imported here so the server backend works without the extension
+        # pylint: disable=import-outside-toplevel
+        from . import _maze  # type: ignore
+        self._maze = _maze
+        self._cache = _maze.Cache(cache_dir) if cache_dir else None
+
+    def formats(self) -> set[str]:
+        """ The valid output formats """
+        return set(self._maze.formats())
+
+    def algorithms(self) -> set[str]:
+        """ The valid generation algorithms """
+        return set(self._maze.algorithms())
+
+    # pylint: disable=too-many-arguments
+    def maze(self, rows: int, cols: int, path_len: int, out_format: str,
+             seed: Optional[str] = None, algorithm: str = 'dfs') -> bytes:
+        """ Generate a maze, returning it encoded as `out_format` """
+        try:
+            return self._maze.generate(rows, cols, seed or None, path_len, out_format,
+                                       self._cache, algorithm)
+        except ValueError as err:
+            raise MazeServerError(str(err)) from err
@@ -0,0 +1,412 @@
+#define _POSIX_C_SOURCE 200809L // open_memstream()
+
+#include "maze_writer.h"
+#include "mazefile.h"
+#include "png_writer.h"
+#include "text-format.h"
+#include <stdio.h>
+#include <stdlib.h> // malloc(), free()
+#include <string.h> // strcmp(), memset()
+
+int maze_format_valid(const char* format) {
+    return strcmp("png", format) == 0 || strcmp("text", format) == 0 || strcmp("bin", format) == 0;
+}
+
+unsigned long maze_layers(const struct maze* maze) {
+    unsigned long layers = 1;
+    for (unsigned d = 0; d + 2 < maze->dims; d++) layers *= maze->dims_array[d];
+    return layers;
+}
+
+/**
+ * Get the flags of a row of cells from a maze of two or three dimensions
+ *
+ * The last two dimensions are the rows and columns, and the rows of each
+ * layer follow on from the last, so `r` counts rows across every layer.
+ * Passages in the first dimension of a three dimensional maze lead to the
+ * next and previous layers.
+ *
+ * Args:
+ * - maze: the maze to read
+ * - r: the row to read
+ * - current: the index of a cell to mark, or `NO_CELL`
+ * - row: output, as long as the last dimension
+ */
+static void maze_row(const struct maze* maze, unsigned long r, unsigned long current, unsigned char* row) {
+    unsigned east = maze->dims - 1, south = maze->dims - 2;
+    unsigned long cols = maze->dims_array[east];
+    if (maze->grid) {
+        // Straight from the bits of each cell, without branches, so it vectorizes
+        const grid_cell_t* cells = &maze->grid[r * cols];
+        grid_cell_t next = 0, prev = 0;
+        for (unsigned d = 0; d < south; d++) {
+            next |= GRID_PASSAGE(DIR_PLUS(d));
+            prev |= GRID_PASSAGE(DIR_MINUS(d));
+        }
+        for (unsigned long c = 0; c < cols; c++) {
+            unsigned cell = cells[c];
+            row[c] = (unsigned char) (((cell >> DIR_PLUS(east)) & 1u) * ROW_EAST
+                    | ((cell >> DIR_PLUS(south)) & 1u) * ROW_SOUTH
+                    | (unsigned) ((cell & GRID_VISITED) != 0) * ROW_VISITED
+                    | (unsigned) ((cell & next) != 0) * ROW_NEXT_LAYER
+                    | (unsigned) ((cell & prev) != 0) * ROW_PREV_LAYER);
+        }
+        if (current != NO_CELL && current / cols == r) row[current % cols] |= ROW_MARK;
+        return;
+    }
+    for (unsigned long c = 0; c < cols; c++) {
+        unsigned long index = r * cols + c;
+        unsigned char flags = 0;
+        if (maze_passage(maze, index, DIR_PLUS(east))) flags |= ROW_EAST;
+        if (maze_passage(maze, index, DIR_PLUS(south))) flags |= ROW_SOUTH;
+        if (maze_visited(maze, index)) flags |= ROW_VISITED;
+        if (index == current) flags |= ROW_MARK;
+        for (unsigned d = 0; d < south; d++) {
+            if (maze_passage(maze, index, DIR_PLUS(d))) flags |= ROW_NEXT_LAYER;
+            if (maze_passage(maze, index, DIR_MINUS(d))) flags |= ROW_PREV_LAYER;
+        }
+        row[c] = flags;
+    }
+}
+
+/**
+ * Mark the path of `solution` through a row from `maze_row()`
+ * A passage between two cells on the path must be part of it, as mazes have
+ * no loops.
+ */
+static void mark_solution(const struct maze* maze, const struct maze_solution* solution, unsigned long r, unsigned char* row) {
+    unsigned long rows = maze->dims_array[0];
+    unsigned long cols = maze->dims_array[1];
+    for (unsigned long c = 0; c < cols; c++) {
+        unsigned long index = r * cols + c;
+        if (!solution_has(solution, index)) continue;
+        row[c] |= ROW_MARK;
+        if ((row[c] & ROW_EAST) && c + 1 < cols && solution_has(solution, index + 1)) row[c] |= ROW_MARK_EAST;
+        if ((row[c] & ROW_SOUTH) && r + 1 < rows && solution_has(solution, index + cols)) row[c] |= ROW_MARK_SOUTH;
+    }
+}
+
+int next_maze_row(void* maze_rows, unsigned char* row) {
+    struct maze_rows* rows = maze_rows;
+    maze_row(rows->maze, rows->next, rows->current, row);
+    if (rows->solution) mark_solution(rows->maze, rows->solution, rows->next, row);
+    rows->next++;
+    return 0;
+}
+
+/**
+ * Produces the lines of an image in order, top to bottom
+ * `line` is filled with characters from `text-format.h`.
+ *
+ * Return: 0 on success, nonzero on failure
+ */
+typedef int (*line_source_t)(void* ctx, char* line);
+
+/* Rasterizes the rows of cells from a `row_source_t` into lines */
+struct row_lines {
+    row_source_t next_row;
+    void* ctx;
+    unsigned long cols;
+    int hide_unvisited;
+    unsigned char* row;  // the row of cells the last two lines came from
+    unsigned long next;  // the next line, counting the border on top
+};
+
+static void row_lines_init(struct row_lines* lines, row_source_t next_row, void* ctx, unsigned long cols, int hide_unvisited) {
+    lines->next_row = next_row;
+    lines->ctx = ctx;
+    lines->cols = cols;
+    lines->hide_unvisited = hide_unvisited;
+    lines->row = malloc(cols);
+    lines->next = 0;
+}
+
+// A `line_source_t` over a `struct row_lines`
+static int next_row_line(void* row_lines, char* line) {
+    struct row_lines* lines = row_lines;
+    int err = 0;
+    if (lines->next == 0) {
+        raster_border(line, lines->cols);
+    } else if (lines->next % 2 == 1) {
+        err = lines->next_row(lines->ctx, lines->row);
+        if (!err) raster_cells(line, lines->row, lines->cols, lines->hide_unvisited);
+    } else {
+        raster_south(line, lines->row, lines->cols);
+    }
+    lines->next++;
+    return err;
+}
+
+/**
+ * Write lines as plaintext, using ' ' for paths and '#' for walls
+ *
+ * Lines are written as soon as `next_line` produces them, so only one line
+ * is held at a time.
+ *
+ * Return: 0 on success, nonzero on failure
+ */
+static int write_lines_text(FILE* file, size_t width, size_t height, line_source_t next_line, void* ctx) {
+    char* line = malloc(width + 1);
+    line[width] = '\n';
+
+    int err = 0;
+    for (size_t y = 0; y < height && !err; y++) {
+        err = next_line(ctx, line);
+        if (!err) fwrite(line, 1, width + 1, file);
+    }
+
+    free(line);
+    return err || ferror(file);
+}
+
+/**
+ * Write lines as a png
+ *
+ * Like `write_lines_text()`, only one line is held at a time.
+ *
+ * Return: 0 on success, nonzero on failure
+ */
+static int write_lines_png(FILE* file, size_t width, size_t height, line_source_t next_line, void* ctx) {
+    png_writer_t writer = new_png_writer(file, width, height);
+    if (!writer) return 1;
+    char* line = malloc(width);
+
+    int err = 0;
+    for (size_t y = 0; y < height && !err; y++) {
+        err = next_line(ctx, line);
+        if (!err) err = png_writer_line(writer, line);
+    }
+
+    free(line);
+    // Always finish, so the writer gets freed
+    return png_writer_finish(writer) || err;
+}
+
+/**
+ * Write rows of cells as png or text, a pair of lines per row
+ * Unvisited cells are hidden in pngs.
+ *
+ * Return: 0 on success, nonzero on failure
+ */
+static int write_rows_image(FILE* file, unsigned long rows, unsigned long cols, row_source_t next_row, void* ctx, const char* format) {
+    int png = strcmp("png", format) == 0;
+    struct row_lines lines;
+    row_lines_init(&lines, next_row, ctx, cols, png);
+    int err;
+    if (png) {
+        err = write_lines_png(file, RASTER_WIDTH(cols), RASTER_HEIGHT(rows), next_row_line, &lines);
+    } else {
+        err = write_lines_text(file, RASTER_WIDTH(cols), RASTER_HEIGHT(rows), next_row_line, &lines);
+    }
+    free(lines.row);
+    return err;
+}
+
+/*
+ * The layers of a maze laid out side by side in a sheet, `across` layers to
+ * each row of the sheet. Only the current row of cells of each layer in the
+ * current row of the sheet is held.
+ */
+struct sheet_lines {
+    const struct maze* maze;
+    unsigned long layers;
+    unsigned long across;
+    struct maze_rows* cursors; // where each layer in the current row is up to
+    struct row_lines* lines;   // rasterizing each of `cursors`
+    unsigned long next;        // the next line of the whole sheet
+};
+
+// A `line_source_t` over a `struct sheet_lines`
+static int next_sheet_line(void* sheet_lines, char* line) {
+    struct sheet_lines* sheet = sheet_lines;
+    const struct maze* maze = sheet->maze;
+    unsigned long rows = maze->dims_array[maze->dims - 2];
+    size_t width = RASTER_WIDTH(maze->dims_array[maze->dims - 1]);
+    size_t height = RASTER_HEIGHT(rows);
+
+    // The first layer in this row of the sheet
+    unsigned long first = sheet->next / height * sheet->across;
+    if (sheet->next % height == 0) {
+        for (unsigned long i = 0; i < sheet->across; i++) {
+            sheet->cursors[i].next = (first + i) * rows;
+            sheet->lines[i].next = 0;
+        }
+    }
+
+    int err = 0;
+    for (unsigned long i = 0; i < sheet->across && !err; i++) {
+        // The last row of the sheet may not be full
+        if (first + i < sheet->layers) {
+            err = next_row_line(&sheet->lines[i], line + i * width);
+        } else {
+            memset(line + i * width, WALL, width);
+        }
+    }
+    sheet->next++;
+    return err;
+}
+
+/**
+ * Write every layer of a maze of more than two dimensions into one image, as
+ * png or text
+ * The sheet is as close to square in layers as it can be.
+ *
+ * Return: 0 on success, nonzero on failure
+ */
+static int write_maze_sheet(FILE* file, const struct maze* maze, const char* format) {
+    unsigned long rows = maze->dims_array[maze->dims - 2];
+    unsigned long cols = maze->dims_array[maze->dims - 1];
+    int png = strcmp("png", format) == 0;
+
+    struct sheet_lines sheet;
+    sheet.maze = maze;
+    sheet.layers = maze_layers(maze);
+    sheet.across = 1;
+    while (sheet.across * sheet.across < sheet.layers) sheet.across++;
+    sheet.cursors = malloc(sheet.across * sizeof(struct maze_rows));
+    sheet.lines = malloc(sheet.across * sizeof(struct row_lines));
+    sheet.next = 0;
+    for (unsigned long i = 0; i < sheet.across; i++) {
+        sheet.cursors[i].maze = maze;
+        sheet.cursors[i].current = NO_CELL;
+        sheet.cursors[i].next = 0;
+        sheet.cursors[i].solution = NULL;
+        row_lines_init(&sheet.lines[i], next_maze_row, &sheet.cursors[i], cols, png);
+    }
+
+    size_t width = sheet.across * RASTER_WIDTH(cols);
+    size_t height = (sheet.layers + sheet.across - 1) / sheet.across * RASTER_HEIGHT(rows);
+    int err;
+    if (png) {
+        err = write_lines_png(file, width, height, next_sheet_line, &sheet);
+    } else {
+        err = write_lines_text(file, width, height, next_sheet_line, &sheet);
+    }
+
+    for (unsigned long i = 0; i < sheet.across; i++) free(sheet.lines[i].row);
+    free(sheet.lines);
+    free(sheet.cursors);
+    return err;
+}
+
+/**
+ * Write rows of cells in the binary maze format
+ *
+ * Like `write_lines_text()`, only one row is held at a time.
+ *
+ * Return: 0 on success, nonzero on failure
+ */
+static int write_rows_bin(FILE* file, unsigned long rows, unsigned long cols, row_source_t next_row, void* ctx, uint64_t seed, unsigned algorithm) {
+    unsigned long dims_array[] = {rows, cols};
+    bin_writer_t writer = new_bin_writer(file, 2, dims_array, seed, algorithm);
+    unsigned char* row = malloc(cols);
+
+    int err = 0;
+    for (unsigned long r = 0; r < rows && !err; r++) {
+        err = next_row(ctx, row);
+        if (err) break;
+        for (unsigned long c = 0; c < cols; c++) {
+            unsigned walls = 0;
+            if (!(row[c] & ROW_SOUTH)) walls |= 1u;
+            if (!(row[c] & ROW_EAST)) walls |= 2u;
+            bin_writer_cell(writer, walls);
+        }
+    }
+
+    free(row);
+    return bin_writer_finish(writer) || err;
+}
+
+/** Write a maze of any number of dimensions in the binary maze format */
+static int write_maze_bin(FILE* file, const struct maze* maze, uint64_t seed, unsigned algorithm) {
+    bin_writer_t writer = new_bin_writer(file, maze->dims, maze->dims_array, seed, algorithm);
+    for (unsigned long i = 0; i < maze->size; i++) {
+        unsigned walls = 0;
+        for (unsigned d = 0; d < maze->dims; d++) {
+            if (!maze_passage(maze, i, DIR_PLUS(d))) walls |= 1u << d;
+        }
+        bin_writer_cell(writer, walls);
+    }
+    return bin_writer_finish(writer);
+}
+
+int write_maze_rows(FILE* file, unsigned long rows, unsigned long cols, row_source_t next_row, void* ctx,
+        const char* format, uint64_t seed, unsigned algorithm) {
+    if (strcmp("png", format) == 0 || strcmp("text", format) == 0) return write_rows_image(file, rows, cols, next_row, ctx, format);
+    if (strcmp("bin", format) == 0) return write_rows_bin(file, rows, cols, next_row, ctx, seed, algorithm);
+    return 1;
+}
+
+int write_maze(FILE* file, const struct maze* maze, const char* format, uint64_t seed, unsigned algorithm) {
+    if (strcmp("bin", format) == 0) return write_maze_bin(file, maze, seed, algorithm);
+    if (maze->dims < 2) return 1;
+    if (maze->dims > MAZE_RASTER_MAX_DIMS) return 1;
+    if (maze->dims > 2) return maze_format_valid(format) ? write_maze_sheet(file, maze, format) : 1;
+
+    struct maze_rows rows = { maze, NO_CELL, 0, NULL };
+    return write_maze_rows(file, maze->dims_array[0], maze->dims_array[1], next_maze_row, &rows, format, seed, algorithm);
+}
+
+int write_solved_maze(FILE* file, const struct maze* maze, const struct maze_solution* solution, const char* format) {
+    if (maze->dims != 2 || strcmp("bin", format) == 0) return 1;
+
+    struct maze_rows rows = { maze, NO_CELL, 0, solution };
+    return write_maze_rows(file, maze->dims_array[0], maze->dims_array[1], next_maze_row, &rows, format, 0, 0);
+}
+
+int write_maze_layer(FILE* file, const struct maze* maze, unsigned long layer, const char* format) {
+    if (maze->dims < 2 || maze->dims > MAZE_RASTER_MAX_DIMS || layer >= maze_layers(maze) || strcmp("bin", format) == 0) {
+        return 1;
+    }
+
+    unsigned long rows = maze->dims_array[maze->dims - 2];
+    struct maze_rows layer_rows = { maze, NO_CELL, layer * rows, NULL };
+    return write_maze_rows(file, rows, maze->dims_array[maze->dims - 1], next_maze_row, &layer_rows, format, 0, 0);
+}
+
+/**
+ * Finish encoding into a memory stream
+ * On failure the buffer is freed, and `out` and `len` are left alone.
+ */
+static int close_memstream(FILE* file, int err, char** buf, size_t* buf_len, char** out, size_t* len) {
+    // The buffer and its length are only up to date once the stream's closed
+    err = fclose(file) || err;
+    if (err) {
+        free(*buf);
+        return 1;
+    }
+    *out = *buf;
+    *len = *buf_len;
+    return 0;
+}
+
+int encode_maze(const struct maze* maze, const char* format, uint64_t seed, unsigned algorithm, char** out, size_t* len) {
+    char* buf = NULL;
+    size_t buf_len = 0;
+    FILE* file = open_memstream(&buf, &buf_len);
+    if (!file) return 1;
+
+    int err = write_maze(file, maze, format, seed, algorithm);
+    return close_memstream(file, err, &buf, &buf_len, out, len);
+}
+
+int encode_solved_maze(const struct maze* maze, const struct maze_solution* solution, const char* format, char** out, size_t* len) {
+    char* buf = NULL;
+    size_t buf_len = 0;
+    FILE* file = open_memstream(&buf, &buf_len);
+    if (!file) return 1;
+
+    int err = write_solved_maze(file, maze, solution, format);
+    return close_memstream(file, err, &buf, &buf_len, out, len);
+}
+
+int encode_maze_rows(unsigned long rows, unsigned long cols, row_source_t next_row, void* ctx,
+        const char* format, uint64_t seed, unsigned algorithm, char** out, size_t* len) {
+    char* buf = NULL;
+    size_t buf_len = 0;
+    FILE* file = open_memstream(&buf, &buf_len);
+    if (!file) return 1;
+
+    int err = write_maze_rows(file, rows, cols, next_row, ctx, format, seed, algorithm);
+    return close_memstream(file, err, &buf, &buf_len, out, len);
+}
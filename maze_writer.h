@@ -0,0 +1,138 @@
+#ifndef MAZE_GEN_MAZE_WRITER_H
+#define MAZE_GEN_MAZE_WRITER_H
+
+#include "generator.h"
+#include "raster.h"
+#include "solve.h"
+#include <stdint.h> // uint64_t
+#include <stdio.h>  // FILE
+#include <stdlib.h> // size_t
+
+/*
+ * Writing mazes out, to files or to memory
+ *
+ * Formats are named like the `--format` flag: "png", "text" or "bin". bin
+ * works for any number of dimensions. png and text draw two dimensional
+ * layers: the last two dimensions are the rows and columns, and there's a
+ * layer for every combination of the others. Cells with passages to other
+ * layers are marked with the `LAYER_*` characters from `text-format.h`.
+ * `seed` and `algorithm` are only recorded by bin, and are otherwise ignored.
+ *
+ * Nothing here keeps any state between calls, so different threads can write
+ * different mazes at once.
+ */
+
+/** Space separated list of the format names */
+#define MAZE_FORMATS "png text bin"
+
+/**
+ * Check whether `format` names a format
+ *
+ * Return: nonzero if it does
+ */
+int maze_format_valid(const char* format);
+
+/**
+ * The most dimensions a maze can have to be written as png or text
+ * Passages between layers are only marked as going to the next or previous
+ * one, which can't say which dimension they're along past the first.
+ */
+#define MAZE_RASTER_MAX_DIMS 3
+
+/**
+ * Write a maze to `file`
+ * As png or text, a maze of three dimensions is written as a sheet of its
+ * layers side by side, a layer's row of cells at a time. Mazes of more than
+ * `MAZE_RASTER_MAX_DIMS` can only be written as bin.
+ *
+ * Return: 0 on success, nonzero on failure
+ */
+int write_maze(FILE* file, const struct maze* maze, const char* format, uint64_t seed, unsigned algorithm);
+
+/**
+ * Count the two dimensional layers of a maze, the product of all but its last
+ * two dimensions
+ */
+unsigned long maze_layers(const struct maze* maze);
+
+/**
+ * Write a single layer of a maze of up to `MAZE_RASTER_MAX_DIMS` to `file`,
+ * as png or text
+ *
+ * Return: 0 on success, nonzero on failure
+ */
+int write_maze_layer(FILE* file, const struct maze* maze, unsigned long layer, const char* format);
+
+/**
+ * Write a two dimensional maze to `file` with the path of `solution` drawn
+ * through it
+ * Only png and text can show a path.
+ *
+ * Return: 0 on success, nonzero on failure
+ */
+int write_solved_maze(FILE* file, const struct maze* maze, const struct maze_solution* solution, const char* format);
+
+/**
+ * Write a two dimensional maze to `file` as it's produced, a row at a time
+ *
+ * Only one row is ever held, so this suits generators like `eller_t` that
+ * never hold the whole maze.
+ *
+ * Args:
+ * - file: where to write
+ * - rows, cols: the size of the maze
+ * - next_row: called once per row, top to bottom
+ * - ctx: passed to `next_row`
+ * - format, seed, algorithm: as for `write_maze()`
+ *
+ * Return: 0 on success, nonzero on failure
+ */
+int write_maze_rows(FILE* file, unsigned long rows, unsigned long cols, row_source_t next_row, void* ctx,
+        const char* format, uint64_t seed, unsigned algorithm);
+
+/**
+ * Encode a maze into a new buffer, like `write_maze()`
+ *
+ * Args:
+ * - out: set to the encoded maze, which the caller must `free()`
+ * - len: set to the length of `out`
+ *
+ * Return: 0 on success, nonzero on failure. On failure nothing is allocated.
+ */
+int encode_maze(const struct maze* maze, const char* format, uint64_t seed, unsigned algorithm, char** out, size_t* len);
+
+/**
+ * Encode a maze with a solution into a new buffer, like `write_solved_maze()`
+ *
+ * Return: 0 on success, nonzero on failure. On failure nothing is allocated.
+ */
+int encode_solved_maze(const struct maze* maze, const struct maze_solution* solution, const char* format, char** out, size_t* len);
+
+/**
+ * Encode a two dimensional maze into a new buffer, like `write_maze_rows()`
+ *
+ * Return: 0 on success, nonzero on failure. On failure nothing is allocated.
+ */
+int encode_maze_rows(unsigned long rows, unsigned long cols, row_source_t next_row, void* ctx,
+        const char* format, uint64_t seed, unsigned algorithm, char** out, size_t* len);
+
+/**
+ * A `row_source_t` over the rows of a maze
+ * Start `next` at 0. The cell at `current` is marked, unless it's `NO_CELL`,
+ * and so is the path of `solution`, unless it's NULL. Only two dimensional
+ * mazes can have a `solution`.
+ *
+ * With more than two dimensions, the rows of each layer follow those of the
+ * layer before, so start `next` at `layer * rows` to read a given layer.
+ */
+struct maze_rows {
+    const struct maze* maze;
+    unsigned long current;
+    unsigned long next;
+    const struct maze_solution* solution;
+};
+
+/** Read the next row from a `struct maze_rows` */
+int next_maze_row(void* maze_rows, unsigned char* row);
+
+#endif
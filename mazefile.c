@@ -0,0 +1,147 @@
+#define _POSIX_C_SOURCE 200112L // mmap(), fstat()
+
+#include "mazefile.h"
+#include "raster.h"
+#include <fcntl.h>    // open()
+#include <string.h>   // memcmp()
+#include <sys/mman.h> // mmap(), munmap()
+#include <sys/stat.h> // fstat()
+#include <unistd.h>   // close()
+
+#define HEADER_SIZE(dims) (16 + 8 * (size_t)(dims))
+
+/* State for a binary maze being written */
+struct bin_writer {
+    FILE* file;
+    unsigned dims;
+    unsigned char byte; // bits not yet written
+    unsigned used;      // how many bits of `byte` are used
+};
+
+// Write `value` as `size` little endian bytes
+static void write_le(FILE* file, uint64_t value, unsigned size) {
+    for (unsigned i = 0; i < size; i++) {
+        fputc((int)(value & 0xFF), file);
+        value >>= 8;
+    }
+}
+
+// Read `size` little endian bytes
+static uint64_t read_le(const unsigned char* bytes, unsigned size) {
+    uint64_t value = 0;
+    for (unsigned i = size; i-- > 0;) value = (value << 8) | bytes[i];
+    return value;
+}
+
+struct bin_writer* new_bin_writer(FILE* file, unsigned dims, const unsigned long* dims_array, uint64_t seed, unsigned algorithm) {
+    struct bin_writer* writer = malloc(sizeof(struct bin_writer));
+    writer->file = file;
+    writer->dims = dims;
+    writer->byte = 0;
+    writer->used = 0;
+
+    fwrite(MAZEFILE_MAGIC, 1, 4, file);
+    write_le(file, MAZEFILE_VERSION, 1);
+    write_le(file, algorithm, 1);
+    write_le(file, dims, 1);
+    write_le(file, 0, 1);
+    write_le(file, seed, 8);
+    for (unsigned d = 0; d < dims; d++) write_le(file, dims_array[d], 8);
+    return writer;
+}
+
+void bin_writer_cell(struct bin_writer* writer, unsigned walls) {
+    for (unsigned d = 0; d < writer->dims; d++) {
+        writer->byte |= (unsigned char)(((walls >> d) & 1u) << writer->used);
+        if (++writer->used == 8) {
+            fputc(writer->byte, writer->file);
+            writer->byte = 0;
+            writer->used = 0;
+        }
+    }
+}
+
+int bin_writer_finish(struct bin_writer* writer) {
+    if (writer->used) fputc(writer->byte, writer->file);
+    int err = ferror(writer->file);
+    free(writer);
+    return err;
+}
+
+int open_maze_file(const char* path, struct maze_file* file) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return MAZEFILE_ERR_OPEN;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return MAZEFILE_ERR_OPEN;
+    }
+    file->length = (size_t) st.st_size;
+    if (file->length < HEADER_SIZE(0)) {
+        close(fd);
+        return MAZEFILE_ERR_NOT_MAZE;
+    }
+
+    file->map = mmap(NULL, file->length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (file->map == MAP_FAILED) return MAZEFILE_ERR_OPEN;
+
+    const unsigned char* bytes = file->map;
+    int err = 0;
+    if (memcmp(bytes, MAZEFILE_MAGIC, 4) != 0) {
+        err = MAZEFILE_ERR_NOT_MAZE;
+    } else if (bytes[4] != MAZEFILE_VERSION || bytes[6] == 0 || bytes[6] > MAZEFILE_MAX_DIMS
+            || file->length < HEADER_SIZE(bytes[6])) {
+        err = MAZEFILE_ERR_CORRUPT;
+    } else {
+        file->algorithm = bytes[5];
+        file->dims = bytes[6];
+        file->seed = read_le(bytes + 8, 8);
+
+        // Check that the cells are all there, without overflowing
+        uint64_t cells = 1;
+        for (unsigned d = 0; d < file->dims && !err; d++) {
+            uint64_t size = read_le(bytes + 16 + 8 * d, 8);
+            file->dims_array[d] = (unsigned long) size;
+            if (size == 0 || size != file->dims_array[d] || cells > UINT64_MAX / size / file->dims) {
+                err = MAZEFILE_ERR_CORRUPT;
+            } else {
+                cells *= size;
+            }
+        }
+        if (!err && (cells * file->dims + 7) / 8 > file->length - HEADER_SIZE(file->dims)) {
+            err = MAZEFILE_ERR_CORRUPT;
+        }
+        file->bits = bytes + HEADER_SIZE(file->dims);
+    }
+
+    if (err) munmap(file->map, file->length);
+    return err;
+}
+
+void close_maze_file(struct maze_file* file) {
+    munmap(file->map, file->length);
+}
+
+unsigned maze_file_walls(const struct maze_file* file, unsigned long index) {
+    unsigned walls = 0;
+    uint64_t bit = (uint64_t) index * file->dims;
+    for (unsigned d = 0; d < file->dims; d++, bit++) {
+        walls |= (unsigned)((file->bits[bit / 8] >> (bit % 8)) & 1u) << d;
+    }
+    return walls;
+}
+
+void maze_file_row(const struct maze_file* file, unsigned long r, unsigned char* row) {
+    unsigned long cols = file->dims_array[1];
+    // Two bits per cell, so cells never straddle a byte
+    uint64_t bit = (uint64_t) r * cols * 2;
+    for (unsigned long c = 0; c < cols; c++, bit += 2) {
+        unsigned walls = (file->bits[bit / 8] >> (bit % 8)) & 3u;
+        unsigned char flags = ROW_VISITED;
+        if (!(walls & 1u)) flags |= ROW_SOUTH;
+        if (!(walls & 2u)) flags |= ROW_EAST;
+        row[c] = flags;
+    }
+}
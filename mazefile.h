@@ -0,0 +1,111 @@
+#ifndef MAZE_GEN_MAZEFILE_H
+#define MAZE_GEN_MAZEFILE_H
+
+#include <stdint.h> // uint64_t
+#include <stdio.h>  // FILE
+#include <stdlib.h> // size_t
+
+/*
+ * The binary maze format
+ *
+ * All integers are little endian.
+ *
+ * | offset | size       | contents                                        |
+ * |--------|------------|-------------------------------------------------|
+ * | 0      | 4          | magic, "MAZB"                                   |
+ * | 4      | 1          | format version, `MAZEFILE_VERSION`              |
+ * | 5      | 1          | algorithm used to generate the maze             |
+ * | 6      | 1          | number of dimensions, `dims`                    |
+ * | 7      | 1          | reserved, 0                                     |
+ * | 8      | 8          | seed the maze was generated with                |
+ * | 16     | 8 * dims   | size of each dimension                          |
+ * | ...    | ...        | `dims` bits per cell, packed                    |
+ *
+ * Cells are in row-major order. Bit `d` of a cell is set if there's a wall
+ * between the cell and its neighbor at +1 in dimension `d` (for two
+ * dimensions that's the south wall, then the east wall). Walls on the -1 side
+ * belong to the neighbor, and the outer walls are always set. Bits are packed
+ * least significant first, and the last byte is padded with zeros.
+ */
+
+#define MAZEFILE_MAGIC "MAZB"
+#define MAZEFILE_VERSION 1
+#define MAZEFILE_MAX_DIMS 32
+
+/** Algorithms recorded in the header */
+#define MAZEFILE_ALGORITHM_DFS 0
+#define MAZEFILE_ALGORITHM_TILED_DFS 1
+#define MAZEFILE_ALGORITHM_ELLER 2
+#define MAZEFILE_ALGORITHM_PRIM 3
+#define MAZEFILE_ALGORITHM_WILSON 4
+#define MAZEFILE_ALGORITHM_HUNT_AND_KILL 5
+#define MAZEFILE_ALGORITHM_BINARY_TREE 6
+#define MAZEFILE_ALGORITHM_SIDEWINDER 7
+#define MAZEFILE_ALGORITHM_KRUSKAL 8
+
+/** Writes a binary maze a cell at a time */
+typedef struct bin_writer* bin_writer_t;
+
+/**
+ * Start writing a binary maze to `file`
+ *
+ * Return: The new writer. Finish with `bin_writer_finish()`
+ */
+bin_writer_t new_bin_writer(FILE* file, unsigned dims, const unsigned long* dims_array, uint64_t seed, unsigned algorithm);
+
+/**
+ * Write the walls of the next cell
+ * Bit `d` of `walls` is the wall at +1 in dimension `d`.
+ */
+void bin_writer_cell(bin_writer_t writer, unsigned walls);
+
+/**
+ * Finish the file and free the writer. Doesn't close the file.
+ *
+ * Return: 0 on success, nonzero on failure
+ */
+int bin_writer_finish(bin_writer_t writer);
+
+/** A binary maze mapped into memory */
+struct maze_file {
+    unsigned dims;
+    unsigned long dims_array[MAZEFILE_MAX_DIMS];
+    uint64_t seed;
+    unsigned algorithm;
+    /** The packed cells */
+    const unsigned char* bits;
+    /** The whole mapping */
+    void* map;
+    size_t length;
+};
+
+/** Errors from `open_maze_file()` */
+#define MAZEFILE_ERR_OPEN 1
+#define MAZEFILE_ERR_NOT_MAZE 2
+#define MAZEFILE_ERR_CORRUPT 3
+
+/**
+ * Map a binary maze into memory, after checking its header
+ *
+ * Return: 0 on success, or one of the `MAZEFILE_ERR_*` codes. Only on
+ *   success must the file be closed with `close_maze_file()`.
+ */
+int open_maze_file(const char* path, struct maze_file* file);
+
+/**
+ * Unmap a binary maze
+ */
+void close_maze_file(struct maze_file* file);
+
+/**
+ * Get the walls of a cell, in the same form as `bin_writer_cell()`
+ */
+unsigned maze_file_walls(const struct maze_file* file, unsigned long index);
+
+/**
+ * Get the flags of a row of cells from a two dimensional binary maze, as in
+ * `raster.h`. Every cell is considered visited.
+ */
+void maze_file_row(const struct maze_file* file, unsigned long r, unsigned char* row);
+
+#endif
@@ -3,14 +3,65 @@
 #include <stdio.h> // file handling
 
 #include "text-format.h"
+#include "mazefile.h"
+#include "raster.h"
 
-// argv[0]: input png file
+// Convert a two dimensional binary maze straight to text, a row at a time
+static int bin_to_text(const struct maze_file* maze, const char* out_path) {
+    if (maze->dims != 2) {
+        fprintf(stderr, "Error: only two dimensional mazes can be converted\n");
+        return 1;
+    }
+    unsigned long rows = maze->dims_array[0];
+    unsigned long cols = maze->dims_array[1];
+
+    FILE* out = fopen(out_path, "w");
+    if (!out) {
+        fprintf(stderr, "Error: couldn't open `%s` for writing\n", out_path);
+        return 1;
+    }
+
+    size_t width = RASTER_WIDTH(cols);
+    unsigned char* row = malloc(cols);
+    char* line = malloc(width + 1);
+    line[width] = '\n';
+    raster_border(line, cols);
+    fwrite(line, 1, width + 1, out);
+    for (unsigned long r = 0; r < rows; r++) {
+        maze_file_row(maze, r, row);
+        raster_cells(line, row, cols, 0);
+        fwrite(line, 1, width + 1, out);
+        raster_south(line, row, cols);
+        fwrite(line, 1, width + 1, out);
+    }
+    free(line);
+    free(row);
+
+    int err = ferror(out);
+    err = fclose(out) || err;
+    if (err) fprintf(stderr, "Error: failed to write `%s`\n", out_path);
+    return err;
+}
+
+// argv[0]: input png file, or binary maze
 // argv[1]: output text file
 int main(int argc, char** argv) {
+    // Binary mazes are mapped and converted directly
+    struct maze_file maze;
+    int status = open_maze_file(argv[1], &maze);
+    if (status == 0) {
+        status = bin_to_text(&maze, argv[2]);
+        close_maze_file(&maze);
+        return status;
+    } else if (status == MAZEFILE_ERR_CORRUPT) {
+        fprintf(stderr, "Error: `%s` is a corrupt binary maze\n", argv[1]);
+        return 1;
+    }
+
     struct img img;
 
     // TODO print an actual error message
-    int status = readpng(argv[1], &img);
+    status = readpng(argv[1], &img);
     if (status != 0) {
         return status;
     }
@@ -25,6 +76,12 @@ int main(int argc, char** argv) {
                 fputc(SPACE, file);
             } else if (p.red == 255 && p.green == 0 && p.blue == 0) {
                 fputc(PATH, file);
+            } else if (p.red == 0 && p.green == 192 && p.blue == 0) {
+                fputc(LAYER_NEXT, file);
+            } else if (p.red == 0 && p.green == 0 && p.blue == 255) {
+                fputc(LAYER_PREV, file);
+            } else if (p.red == 0 && p.green == 192 && p.blue == 255) {
+                fputc(LAYER_BOTH, file);
             } else if (p.red == 0 && p.green ==0 && p.blue == 0) {
                 fputc(WALL, file);
             } else {
@@ -0,0 +1,80 @@
+#include "png_writer.h"
+#include "raster.h"
+#include <png.h>
+#include <stdlib.h> // malloc(), free()
+
+/* State for a png being written */
+struct png_writer {
+    png_structp png;
+    png_infop info;
+    png_bytep pixels;      // one line of RGB pixels
+    png_uint_32 width;
+    int failed;            // libpng hit an error, so the png is unusable
+};
+
+// Write the png header. libpng reports errors by longjmp, so keep it contained here.
+static int start_png(struct png_writer* writer, FILE* file, png_uint_32 height) {
+    if (setjmp(png_jmpbuf(writer->png))) return 1;
+    png_init_io(writer->png, file);
+    png_set_IHDR(writer->png, writer->info, writer->width, height,
+            8, PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE,
+            PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    // Mazes are flat runs of a few colors, which zlib squeezes better unfiltered,
+    // and trying every filter on every line is most of the time spent encoding
+    png_set_filter(writer->png, PNG_FILTER_TYPE_BASE, PNG_FILTER_NONE);
+    png_write_info(writer->png, writer->info);
+    return 0;
+}
+
+// Write a line of pixels
+static int write_pixels(struct png_writer* writer) {
+    if (setjmp(png_jmpbuf(writer->png))) return 1;
+    png_write_row(writer->png, writer->pixels);
+    return 0;
+}
+
+// Write the end of the png
+static int end_png(struct png_writer* writer) {
+    if (setjmp(png_jmpbuf(writer->png))) return 1;
+    png_write_end(writer->png, NULL);
+    return 0;
+}
+
+// Free the writer and everything it holds
+static void free_writer(struct png_writer* writer) {
+    png_destroy_write_struct(&writer->png, &writer->info);
+    free(writer->pixels);
+    free(writer);
+}
+
+struct png_writer* new_png_writer(FILE* file, unsigned long width, unsigned long height) {
+    if (width == 0 || height == 0 || width > PNG_UINT_31_MAX || height > PNG_UINT_31_MAX) return NULL;
+
+    struct png_writer* writer = calloc(1, sizeof(struct png_writer));
+    writer->width = (png_uint_32) width;
+    writer->pixels = malloc(3 * (size_t) width);
+    writer->png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    if (writer->png) writer->info = png_create_info_struct(writer->png);
+    if (!writer->pixels || !writer->png || !writer->info || start_png(writer, file, (png_uint_32) height)) {
+        free_writer(writer);
+        return NULL;
+    }
+    return writer;
+}
+
+int png_writer_line(struct png_writer* writer, const char* line) {
+    if (writer->failed) return 1;
+    raster_pixels(writer->pixels, line, writer->width);
+    writer->failed = write_pixels(writer);
+    return writer->failed;
+}
+
+int png_writer_finish(struct png_writer* writer) {
+    int failed = writer->failed || end_png(writer);
+    free_writer(writer);
+    return failed;
+}
+
+void png_writer_abandon(struct png_writer* writer) {
+    free_writer(writer);
+}
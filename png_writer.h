@@ -0,0 +1,45 @@
+#ifndef MAZE_GEN_PNG_WRITER_H
+#define MAZE_GEN_PNG_WRITER_H
+
+#include <stdio.h> // FILE
+
+/**
+ * Writes a png a line at a time
+ *
+ * Lines are given as characters from `text-format.h`, and converted to
+ * pixels with `raster_pixels()` as they're written, so only a single line of
+ * pixels is ever held.
+ */
+typedef struct png_writer* png_writer_t;
+
+/**
+ * Start writing a png to `file`
+ *
+ * Return: The new writer, or NULL if the png couldn't be started. Finish with
+ *   `png_writer_finish()`
+ */
+png_writer_t new_png_writer(FILE* file, unsigned long width, unsigned long height);
+
+/**
+ * Write the next line of the image
+ * line must be `width` characters long.
+ *
+ * Return: 0 on success, nonzero on failure
+ */
+int png_writer_line(png_writer_t writer, const char* line);
+
+/**
+ * Finish the png and free the writer
+ * Every line must have been written. Doesn't close the file.
+ *
+ * Return: 0 on success, nonzero on failure
+ */
+int png_writer_finish(png_writer_t writer);
+
+/**
+ * Free the writer without finishing the png, e.g. when the rest of its lines
+ * turn out to be bad. Whatever was written so far is left in the file.
+ */
+void png_writer_abandon(png_writer_t writer);
+
+#endif
@@ -0,0 +1,82 @@
+#include "pool.h"
+#include "stats.h"
+#include <stdlib.h> // malloc(), free(), NULL
+
+// Nodes in the first slab. Each slab after that is twice as big, up to the max.
+#define MIN_SLAB_NODES 64
+#define MAX_SLAB_NODES 65536
+
+/* A block of nodes. The nodes follow the header in the same allocation. */
+struct slab {
+    struct slab* next; // the previously allocated slab
+};
+
+/* A freed node, waiting to be reused */
+struct free_node {
+    struct free_node* next;
+};
+
+/* Metadata for a pool */
+struct pool {
+    size_t node_size;           // size of each node, padded for alignment
+    struct slab* slabs;         // every slab, most recent first
+    struct free_node* free;     // nodes that have been returned to the pool
+    char* next;                 // next never used node in the current slab
+    char* end;                  // end of the current slab
+    size_t slab_nodes;          // how many nodes to put in the next slab
+};
+
+// Round up to a multiple of this, so every node is suitably aligned
+#define ALIGN (sizeof(void*) > sizeof(long double) ? sizeof(void*) : sizeof(long double))
+
+struct pool* new_pool(size_t node_size) {
+    struct pool* pool = stats_malloc(sizeof(struct pool));
+    if (!pool) return NULL;
+    if (node_size < sizeof(struct free_node)) node_size = sizeof(struct free_node);
+    pool->node_size = (node_size + ALIGN - 1) / ALIGN * ALIGN;
+    pool->slabs = NULL;
+    pool->free = NULL;
+    pool->next = NULL;
+    pool->end = NULL;
+    pool->slab_nodes = MIN_SLAB_NODES;
+    return pool;
+}
+
+void* pool_alloc(struct pool* pool) {
+    // Reuse freed nodes first
+    if (pool->free != NULL) {
+        struct free_node* node = pool->free;
+        pool->free = node->next;
+        return node;
+    }
+
+    // Out of room, start a new slab
+    if (pool->next == pool->end) {
+        size_t header = (sizeof(struct slab) + ALIGN - 1) / ALIGN * ALIGN;
+        struct slab* slab = stats_malloc(header + pool->slab_nodes * pool->node_size);
+        slab->next = pool->slabs;
+        pool->slabs = slab;
+        pool->next = (char*)slab + header;
+        pool->end = pool->next + pool->slab_nodes * pool->node_size;
+        if (pool->slab_nodes < MAX_SLAB_NODES) pool->slab_nodes *= 2;
+    }
+
+    void* node = pool->next;
+    pool->next += pool->node_size;
+    return node;
+}
+
+void pool_free(struct pool* pool, void* node) {
+    struct free_node* freed = node;
+    freed->next = pool->free;
+    pool->free = freed;
+}
+
+void pool_deallocate(struct pool* pool) {
+    while (pool->slabs != NULL) {
+        struct slab* slab = pool->slabs;
+        pool->slabs = slab->next;
+        stats_free(slab);
+    }
+    stats_free(pool);
+}
@@ -0,0 +1,38 @@
+#ifndef MAZE_GEN_POOL_H
+#define MAZE_GEN_POOL_H
+
+#include <stddef.h> // size_t
+
+/**
+ * A pool of fixed size nodes
+ *
+ * Nodes are handed out from large slabs rather than allocated one at a time,
+ * and freed nodes are kept on a free list for reuse. Everything the pool ever
+ * handed out is released at once by `pool_deallocate()`.
+ */
+typedef struct pool* pool_t;
+
+/**
+ * Instantiate a new pool
+ * node_size is the size of every node the pool will hand out.
+ * Returns NULL if it can't be allocated.
+ */
+pool_t new_pool(size_t node_size);
+
+/**
+ * Get a node from the pool.
+ * The node's contents are undefined.
+ */
+void* pool_alloc(pool_t pool);
+
+/**
+ * Return a node to the pool so it can be handed out again.
+ */
+void pool_free(pool_t pool, void* node);
+
+/**
+ * Free the pool, and every node that came from it.
+ */
+void pool_deallocate(pool_t pool);
+
+#endif
@@ -0,0 +1,81 @@
+#include "algorithms.h"
+#include "stats.h"
+#include <stdlib.h> // malloc(), realloc(), free()
+
+// Set on cells while they're in the frontier. Free, as the passage and parent
+// bits stop short of it.
+#define IN_FRONTIER ((grid_cell_t)0x4000)
+
+/* The unvisited cells next to the maze, in no particular order */
+struct frontier {
+    unsigned long* cells;
+    size_t size;
+    size_t cap;
+};
+
+// Add the unvisited neighbors of `index` to the frontier
+static void add_neighbors(struct maze* maze, struct frontier* frontier, unsigned long index) {
+    grid_cell_t* grid = maze->grid;
+    for (unsigned dir = 0; dir < 2 * maze->dims; dir++) {
+        unsigned long neigh;
+        if (!maze_neighbor(maze, index, dir, &neigh) || (grid[neigh] & (GRID_VISITED | IN_FRONTIER))) continue;
+        if (frontier->size == frontier->cap) {
+            frontier->cap *= 2;
+            frontier->cells = stats_realloc(frontier->cells, frontier->cap * sizeof(unsigned long));
+        }
+        grid[neigh] |= IN_FRONTIER;
+        frontier->cells[frontier->size++] = neigh;
+    }
+}
+
+void carve_prim(struct maze* maze, unsigned long limit, struct rng* rng, step_func_t write_step, void* step_ctx) {
+    unsigned int step = 0;
+    if (write_step) write_step(step_ctx, maze, NO_CELL, step++);
+    STATS_PHASE_START(timer);
+    grid_cell_t* grid = maze->grid;
+    unsigned dirs = 2 * maze->dims;
+    uint64_t peak_frontier = 0, visited = 1;
+
+    struct frontier frontier = { stats_malloc(1024 * sizeof(unsigned long)), 0, 1024 };
+
+    unsigned long start = (unsigned long) rng_below(rng, maze->size);
+    grid[start] |= GRID_VISITED;
+    if (write_step) write_step(step_ctx, maze, start, step++);
+    add_neighbors(maze, &frontier, start);
+
+    while (frontier.size > 0 && !(limit && visited >= limit)) {
+        if (frontier.size > peak_frontier) peak_frontier = frontier.size;
+
+        // Take a random cell out of the frontier
+        size_t pick = (size_t) rng_below(rng, frontier.size);
+        unsigned long cell = frontier.cells[pick];
+        frontier.cells[pick] = frontier.cells[--frontier.size];
+
+        // Join it to a random neighbor that's already in the maze
+        unsigned choices[2 * GRID_MAX_DIMS];
+        unsigned long neighs[2 * GRID_MAX_DIMS];
+        unsigned num_choices = 0;
+        for (unsigned dir = 0; dir < dirs; dir++) {
+            unsigned long neigh;
+            if (maze_neighbor(maze, cell, dir, &neigh) && (grid[neigh] & GRID_VISITED)) {
+                choices[num_choices] = dir;
+                neighs[num_choices++] = neigh;
+            }
+        }
+        unsigned pick_dir = (unsigned) rng_below(rng, num_choices);
+        grid[cell] = (grid_cell_t)((grid[cell] & ~IN_FRONTIER) | GRID_PASSAGE(choices[pick_dir]) | GRID_VISITED);
+        grid[neighs[pick_dir]] |= GRID_PASSAGE(DIR_OPPOSITE(choices[pick_dir]));
+        visited++;
+
+        if (write_step) write_step(step_ctx, maze, cell, step++);
+        add_neighbors(maze, &frontier, cell);
+    }
+
+    // Stopping early leaves cells flagged
+    for (size_t i = 0; i < frontier.size; i++) grid[frontier.cells[i]] &= (grid_cell_t) ~IN_FRONTIER;
+    stats_free(frontier.cells);
+
+    STATS_SEARCH(peak_frontier, visited);
+    STATS_PHASE_END(MAZE_PHASE_CARVE, timer);
+    if (write_step) write_step(step_ctx, maze, NO_CELL, step++);
+}
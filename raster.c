@@ -0,0 +1,266 @@
+#include "raster.h"
+#include "text-format.h"
+#include <string.h> // memset()
+
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#define RASTER_X86 1
+#include <immintrin.h>
+#endif
+
+/*
+ * Each function has a scalar version that works everywhere and handles the
+ * tails of lines, and on x86 a version that does 16 cells at a time with SSE2,
+ * which every x86-64 cpu has, and 32 at a time with AVX2 when the cpu has it.
+ * They all produce exactly the same lines.
+ */
+
+// The color of each character of a line. Anything else is a wall.
+static const unsigned char char_colors[256][3] = {
+    [(unsigned char) SPACE] = { 255, 255, 255 },
+    [(unsigned char) PATH] = { 255, 0, 0 },
+    [(unsigned char) LAYER_NEXT] = { 0, 192, 0 },
+    [(unsigned char) LAYER_PREV] = { 0, 0, 255 },
+    [(unsigned char) LAYER_BOTH] = { 0, 192, 255 },
+};
+
+static void cells_scalar(char* line, const unsigned char* row, unsigned long from, unsigned long cols, int hide_unvisited) {
+    for (unsigned long c = from; c < cols; c++) {
+        unsigned char flags = row[c];
+        if (flags & ROW_MARK) {
+            line[2 * c + 1] = PATH;
+        } else if (hide_unvisited && !(flags & ROW_VISITED)) {
+            line[2 * c + 1] = WALL;
+        } else if ((flags & ROW_NEXT_LAYER) && (flags & ROW_PREV_LAYER)) {
+            line[2 * c + 1] = LAYER_BOTH;
+        } else if (flags & ROW_NEXT_LAYER) {
+            line[2 * c + 1] = LAYER_NEXT;
+        } else if (flags & ROW_PREV_LAYER) {
+            line[2 * c + 1] = LAYER_PREV;
+        } else {
+            line[2 * c + 1] = SPACE;
+        }
+        if (flags & ROW_MARK_EAST) {
+            line[2 * c + 2] = PATH;
+        } else {
+            line[2 * c + 2] = (flags & ROW_EAST) ? SPACE : WALL;
+        }
+    }
+}
+
+static void south_scalar(char* line, const unsigned char* row, unsigned long from, unsigned long cols) {
+    for (unsigned long c = from; c < cols; c++) {
+        if (row[c] & ROW_MARK_SOUTH) {
+            line[2 * c + 1] = PATH;
+        } else {
+            line[2 * c + 1] = (row[c] & ROW_SOUTH) ? SPACE : WALL;
+        }
+        line[2 * c + 2] = WALL;
+    }
+}
+
+static void pixels_scalar(unsigned char* pixels, const char* line, unsigned long from, unsigned long width) {
+    for (unsigned long x = from; x < width; x++) {
+        const unsigned char* color = char_colors[(unsigned char) line[x]];
+        pixels[3 * x] = color[0];
+        pixels[3 * x + 1] = color[1];
+        pixels[3 * x + 2] = color[2];
+    }
+}
+
+#ifdef RASTER_X86
+
+/*
+ * Flags are tested a whole vector of cells at a time, and the characters
+ * picked with masks, in the same order of precedence as the scalar versions.
+ * The character of each cell and the one east of it are then interleaved.
+ */
+
+// Where `mask` is set, `a`, otherwise `b`
+static inline __m128i select128(__m128i mask, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// Set where `flag` is set in the cell
+static inline __m128i has128(__m128i cells, int flag) {
+    __m128i bit = _mm_set1_epi8((char) flag);
+    return _mm_cmpeq_epi8(_mm_and_si128(cells, bit), bit);
+}
+
+static unsigned long cells_sse2(char* line, const unsigned char* row, unsigned long cols, int hide_unvisited) {
+    unsigned long c = 0;
+    for (; c + 16 <= cols; c += 16) {
+        __m128i cells = _mm_loadu_si128((const __m128i*) &row[c]);
+        __m128i next = has128(cells, ROW_NEXT_LAYER), prev = has128(cells, ROW_PREV_LAYER);
+        __m128i cell = _mm_set1_epi8(SPACE);
+        cell = select128(prev, _mm_set1_epi8(LAYER_PREV), cell);
+        cell = select128(next, _mm_set1_epi8(LAYER_NEXT), cell);
+        cell = select128(_mm_and_si128(next, prev), _mm_set1_epi8(LAYER_BOTH), cell);
+        if (hide_unvisited) cell = select128(has128(cells, ROW_VISITED), cell, _mm_set1_epi8(WALL));
+        cell = select128(has128(cells, ROW_MARK), _mm_set1_epi8(PATH), cell);
+        __m128i east = select128(has128(cells, ROW_EAST), _mm_set1_epi8(SPACE), _mm_set1_epi8(WALL));
+        east = select128(has128(cells, ROW_MARK_EAST), _mm_set1_epi8(PATH), east);
+        _mm_storeu_si128((__m128i*) &line[2 * c + 1], _mm_unpacklo_epi8(cell, east));
+        _mm_storeu_si128((__m128i*) &line[2 * c + 17], _mm_unpackhi_epi8(cell, east));
+    }
+    return c;
+}
+
+static unsigned long south_sse2(char* line, const unsigned char* row, unsigned long cols) {
+    unsigned long c = 0;
+    __m128i wall = _mm_set1_epi8(WALL);
+    for (; c + 16 <= cols; c += 16) {
+        __m128i cells = _mm_loadu_si128((const __m128i*) &row[c]);
+        __m128i south = select128(has128(cells, ROW_SOUTH), _mm_set1_epi8(SPACE), wall);
+        south = select128(has128(cells, ROW_MARK_SOUTH), _mm_set1_epi8(PATH), south);
+        _mm_storeu_si128((__m128i*) &line[2 * c + 1], _mm_unpacklo_epi8(south, wall));
+        _mm_storeu_si128((__m128i*) &line[2 * c + 17], _mm_unpackhi_epi8(south, wall));
+    }
+    return c;
+}
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static inline __m256i select256(__m256i mask, __m256i a, __m256i b) {
+    return _mm256_blendv_epi8(b, a, mask);
+}
+
+AVX2 static inline __m256i has256(__m256i cells, int flag) {
+    __m256i bit = _mm256_set1_epi8((char) flag);
+    return _mm256_cmpeq_epi8(_mm256_and_si256(cells, bit), bit);
+}
+
+// Interleave 32 bytes each of `a` and `b` into `out`. Unpacking works within
+// 128 bit lanes, so the halves come out of order and are put back.
+AVX2 static inline void store_interleaved256(char* out, __m256i a, __m256i b) {
+    __m256i lo = _mm256_unpacklo_epi8(a, b), hi = _mm256_unpackhi_epi8(a, b);
+    _mm256_storeu_si256((__m256i*) out, _mm256_permute2x128_si256(lo, hi, 0x20));
+    _mm256_storeu_si256((__m256i*) (out + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+
+AVX2 static unsigned long cells_avx2(char* line, const unsigned char* row, unsigned long cols, int hide_unvisited) {
+    unsigned long c = 0;
+    for (; c + 32 <= cols; c += 32) {
+        __m256i cells = _mm256_loadu_si256((const __m256i*) &row[c]);
+        __m256i next = has256(cells, ROW_NEXT_LAYER), prev = has256(cells, ROW_PREV_LAYER);
+        __m256i cell = _mm256_set1_epi8(SPACE);
+        cell = select256(prev, _mm256_set1_epi8(LAYER_PREV), cell);
+        cell = select256(next, _mm256_set1_epi8(LAYER_NEXT), cell);
+        cell = select256(_mm256_and_si256(next, prev), _mm256_set1_epi8(LAYER_BOTH), cell);
+        if (hide_unvisited) cell = select256(has256(cells, ROW_VISITED), cell, _mm256_set1_epi8(WALL));
+        cell = select256(has256(cells, ROW_MARK), _mm256_set1_epi8(PATH), cell);
+        __m256i east = select256(has256(cells, ROW_EAST), _mm256_set1_epi8(SPACE), _mm256_set1_epi8(WALL));
+        east = select256(has256(cells, ROW_MARK_EAST), _mm256_set1_epi8(PATH), east);
+        store_interleaved256(&line[2 * c + 1], cell, east);
+    }
+    return c;
+}
+
+AVX2 static unsigned long south_avx2(char* line, const unsigned char* row, unsigned long cols) {
+    unsigned long c = 0;
+    __m256i wall = _mm256_set1_epi8(WALL);
+    for (; c + 32 <= cols; c += 32) {
+        __m256i cells = _mm256_loadu_si256((const __m256i*) &row[c]);
+        __m256i south = select256(has256(cells, ROW_SOUTH), _mm256_set1_epi8(SPACE), wall);
+        south = select256(has256(cells, ROW_MARK_SOUTH), _mm256_set1_epi8(PATH), south);
+        store_interleaved256(&line[2 * c + 1], south, wall);
+    }
+    return c;
+}
+
+/*
+ * The characters of `text-format.h` all differ in their low four bits, so
+ * those index shuffle tables of colors. Each character is checked against the
+ * one expected for its low bits, and anything unexpected is a black wall.
+ */
+#define NIBBLE(ch) ((ch) & 0xf)
+
+static const char nibble_chars[16] = {
+    [NIBBLE(SPACE)] = SPACE, [NIBBLE(PATH)] = PATH,
+    [NIBBLE(LAYER_NEXT)] = LAYER_NEXT, [NIBBLE(LAYER_PREV)] = LAYER_PREV, [NIBBLE(LAYER_BOTH)] = LAYER_BOTH,
+};
+
+// The colors of `char_colors`, one table per channel
+static const unsigned char nibble_colors[3][16] = {
+    { [NIBBLE(SPACE)] = 255, [NIBBLE(PATH)] = 255 },
+    { [NIBBLE(SPACE)] = 255, [NIBBLE(LAYER_NEXT)] = 192, [NIBBLE(LAYER_BOTH)] = 192 },
+    { [NIBBLE(SPACE)] = 255, [NIBBLE(LAYER_PREV)] = 255, [NIBBLE(LAYER_BOTH)] = 255 },
+};
+
+AVX2 static unsigned long pixels_avx2(unsigned char* pixels, const char* line, unsigned long width) {
+    __m128i expected_table = _mm_loadu_si128((const __m128i*) nibble_chars);
+    __m128i color_tables[3];
+    for (int color = 0; color < 3; color++) color_tables[color] = _mm_loadu_si128((const __m128i*) nibble_colors[color]);
+
+    // Where each byte of the three 16 byte stores of RGB comes from, with -1
+    // for bytes another color fills
+    static const char spread[3][3][16] = {
+        {
+            { 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5 },
+            { -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1 },
+            { -1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1 },
+        }, {
+            { -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1 },
+            { 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10 },
+            { -1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1 },
+        }, {
+            { -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1 },
+            { -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1 },
+            { 10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15 },
+        },
+    };
+
+    unsigned long x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i chars = _mm_loadu_si128((const __m128i*) &line[x]);
+        __m128i index = _mm_and_si128(chars, _mm_set1_epi8(0xf));
+        __m128i valid = _mm_cmpeq_epi8(_mm_shuffle_epi8(expected_table, index), chars);
+        __m128i colors[3];
+        for (int color = 0; color < 3; color++) colors[color] = _mm_and_si128(_mm_shuffle_epi8(color_tables[color], index), valid);
+        for (int part = 0; part < 3; part++) {
+            __m128i out = _mm_setzero_si128();
+            for (int color = 0; color < 3; color++) {
+                __m128i shuffle = _mm_loadu_si128((const __m128i*) spread[part][color]);
+                out = _mm_or_si128(out, _mm_shuffle_epi8(colors[color], shuffle));
+            }
+            _mm_storeu_si128((__m128i*) &pixels[3 * x + 16 * (unsigned long) part], out);
+        }
+    }
+    return x;
+}
+
+// Checked on every line, which costs next to nothing next to the line itself
+static int has_avx2(void) {
+    return __builtin_cpu_supports("avx2");
+}
+
+#endif
+
+void raster_border(char* line, unsigned long cols) {
+    memset(line, WALL, RASTER_WIDTH(cols));
+}
+
+void raster_cells(char* line, const unsigned char* row, unsigned long cols, int hide_unvisited) {
+    unsigned long done = 0;
+#ifdef RASTER_X86
+    done = has_avx2() ? cells_avx2(line, row, cols, hide_unvisited) : cells_sse2(line, row, cols, hide_unvisited);
+#endif
+    line[0] = WALL;
+    cells_scalar(line, row, done, cols, hide_unvisited);
+}
+
+void raster_south(char* line, const unsigned char* row, unsigned long cols) {
+    unsigned long done = 0;
+#ifdef RASTER_X86
+    done = has_avx2() ? south_avx2(line, row, cols) : south_sse2(line, row, cols);
+#endif
+    line[0] = WALL;
+    south_scalar(line, row, done, cols);
+}
+
+void raster_pixels(unsigned char* pixels, const char* line, unsigned long width) {
+    unsigned long done = 0;
+#ifdef RASTER_X86
+    if (has_avx2()) done = pixels_avx2(pixels, line, width);
+#endif
+    pixels_scalar(pixels, line, done, width);
+}
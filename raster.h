@@ -0,0 +1,83 @@
+#ifndef MAZE_GEN_RASTER_H
+#define MAZE_GEN_RASTER_H
+
+/*
+ * Rasterizing two dimensional mazes, a row of cells at a time
+ *
+ * A row of cells is an array of flags, one `unsigned char` per cell. Each row
+ * of cells becomes two lines of output: one through the cells themselves, and
+ * one through the walls to their south. An extra border line goes on top.
+ * Lines are made of the characters from `text-format.h`, and are
+ * `2 * cols + 1` characters long.
+ *
+ * On x86 the rasterizing is vectorized, using AVX2 when the cpu supports it.
+ */
+
+/** There's a passage from the cell to its eastern neighbor */
+#define ROW_EAST 0x1
+/** There's a passage from the cell to its southern neighbor */
+#define ROW_SOUTH 0x2
+/** Generation has reached the cell */
+#define ROW_VISITED 0x4
+/** The cell should stand out, e.g. it's the current cell of a step */
+#define ROW_MARK 0x8
+/** The passage to the eastern neighbor should stand out, e.g. it's on a solution */
+#define ROW_MARK_EAST 0x10
+/** The passage to the southern neighbor should stand out */
+#define ROW_MARK_SOUTH 0x20
+/** There's a passage from the cell to the next layer, in mazes of more than two dimensions */
+#define ROW_NEXT_LAYER 0x40
+/** There's a passage from the cell to the previous layer */
+#define ROW_PREV_LAYER 0x80
+
+/**
+ * Produces the rows of a maze in order, top to bottom
+ *
+ * Args:
+ * - ctx: whatever the source needs to keep track of
+ * - row: filled with the flags of the next row of cells
+ *
+ * Return: 0 on success, nonzero on failure
+ */
+typedef int (*row_source_t)(void* ctx, unsigned char* row);
+
+/** The length of a rasterized line for `cols` columns, excluding any newline */
+#define RASTER_WIDTH(cols) (2 * (cols) + 1)
+/** The number of rasterized lines for `rows` rows */
+#define RASTER_HEIGHT(rows) (2 * (rows) + 1)
+
+/**
+ * Fill `line` with the solid wall along the top of the maze
+ */
+void raster_border(char* line, unsigned long cols);
+
+/**
+ * Fill `line` with the line through a row of cells
+ *
+ * Args:
+ * - line: output, `RASTER_WIDTH(cols)` long
+ * - row: the flags of the row of cells
+ * - cols: the number of cells in the row
+ * - hide_unvisited: if nonzero, unvisited cells are drawn as walls
+ */
+void raster_cells(char* line, const unsigned char* row, unsigned long cols, int hide_unvisited);
+
+/**
+ * Fill `line` with the line of walls south of a row of cells
+ */
+void raster_south(char* line, const unsigned char* row, unsigned long cols);
+
+/**
+ * Convert a line to RGB pixels, three bytes per character
+ *
+ * Spaces are white, paths red, passages to the next layer green, to the
+ * previous one blue, and to both cyan. Anything else is a black wall.
+ *
+ * Args:
+ * - pixels: output, `3 * width` bytes long
+ * - line: the line to convert
+ * - width: the number of characters in the line
+ */
+void raster_pixels(unsigned char* pixels, const char* line, unsigned long width);
+
+#endif
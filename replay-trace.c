@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdlib.h> // strtoul(), malloc(), free()
+#include <string.h> // strncmp(), memset()
+
+#include "generator.h"
+#include "maze_writer.h"
+#include "mazefile.h"
+#include "raster.h"
+#include "trace.h"
+
+static const char* usage =
+    "Usage: replay-trace trace_file output [--from step] [--to step] [--format {png|text|bin}]\n"
+    "\n"
+    "Render a trace recorded with `maze --trace`. Without --from or --to, the\n"
+    "finished maze is written to output. With them, each step in the range is\n"
+    "written as output<step>.png, numbered like `maze --write-steps`.\n";
+
+// Step 0 is before the search reaches any cell, so every row is solid wall
+static int blank_row(void* cols, unsigned char* row) {
+    memset(row, 0, *(unsigned long*) cols);
+    return 0;
+}
+
+/** Write the maze at a step to `<prefix><step>.png` */
+static int write_frame(const char* prefix, unsigned long step, struct maze* maze, unsigned long current) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s%04lu.png", prefix, step);
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        fprintf(stderr, "Error: couldn't open `%s` for writing\n", path);
+        return 1;
+    }
+
+    unsigned long rows = maze->dims_array[0], cols = maze->dims_array[1];
+    struct maze_rows maze_rows = { maze, current, 0, NULL };
+    int err = step == 0
+        ? write_maze_rows(file, rows, cols, blank_row, &cols, "png", 0, 0)
+        : write_maze_rows(file, rows, cols, next_maze_row, &maze_rows, "png", 0, 0);
+    err = fclose(file) || err;
+    if (err) fprintf(stderr, "Error: failed to write `%s`\n", path);
+    return err;
+}
+
+/** Write the finished maze to `path` */
+static int write_final(const char* path, const char* format, const struct trace_file* trace, struct maze* maze) {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        fprintf(stderr, "Error: couldn't open `%s` for writing\n", path);
+        return 1;
+    }
+    int err = write_maze(file, maze, format, trace->seed, trace->algorithm);
+    err = fclose(file) || err;
+    if (err) fprintf(stderr, "Error: failed to write `%s`\n", path);
+    return err;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3 || strncmp(argv[1], "-h", 2) == 0) {
+        fprintf(argc < 3 ? stderr : stdout, "%s", usage);
+        return argc < 3 ? 2 : 0;
+    }
+    const char* trace_path = argv[1];
+    const char* out = argv[2];
+    const char* format = "png";
+    unsigned long from = 0, to = (unsigned long) -1;
+    int ranged = 0;
+
+    char* endptr;
+    for (int i = 3; i < argc; i++) {
+        if (i == argc - 1) {
+            fprintf(stderr, "Error: Missing argument for %s.\n", argv[i]);
+            return 2;
+        } else if (strncmp(argv[i], "--from", 7) == 0) {
+            from = strtoul(argv[++i], &endptr, 10);
+            ranged = 1;
+            if (*endptr != '\0') {
+                fprintf(stderr, "Error: `%s` is not a valid step\n", argv[i]);
+                return 2;
+            }
+        } else if (strncmp(argv[i], "--to", 5) == 0) {
+            to = strtoul(argv[++i], &endptr, 10);
+            ranged = 1;
+            if (*endptr != '\0') {
+                fprintf(stderr, "Error: `%s` is not a valid step\n", argv[i]);
+                return 2;
+            }
+        } else if (strncmp(argv[i], "--format", 9) == 0) {
+            format = argv[++i];
+            if (!maze_format_valid(format)) {
+                fprintf(stderr, "Error: `%s` isn't a valid output format.\n", format);
+                return 2;
+            }
+        } else {
+            fprintf(stderr, "Error: `%s` isn't a flag.\n", argv[i]);
+            return 2;
+        }
+    }
+
+    struct trace_file trace;
+    int status = open_trace_file(trace_path, &trace);
+    if (status == MAZEFILE_ERR_OPEN) {
+        fprintf(stderr, "Error: couldn't open `%s`\n", trace_path);
+        return 1;
+    } else if (status) {
+        fprintf(stderr, "Error: `%s` isn't a valid trace\n", trace_path);
+        return 1;
+    }
+
+    struct maze* maze = trace_start(&trace);
+    if (!maze || (ranged && trace.dims != 2)) {
+        fprintf(stderr, "Error: a %u dimensional trace can't be rendered like that\n", trace.dims);
+        if (maze) clean_maze(maze);
+        close_trace_file(&trace);
+        return 1;
+    }
+    if (!trace.finished) fprintf(stderr, "Warning: `%s` was cut short, the maze isn't finished\n", trace_path);
+
+    // Step 1 is at the start cell, and each event moves on a step
+    unsigned long last = (unsigned long) trace.num_events + 1;
+    if (to > last) to = last;
+    unsigned long current = trace.start;
+    int err = 0;
+    for (unsigned long step = 0; step <= last && !err; step++) {
+        if (step >= 2) {
+            err = trace_apply(maze, &current, trace.events[step - 2]);
+            if (err) {
+                fprintf(stderr, "Error: `%s` is corrupt at step %lu\n", trace_path, step);
+                break;
+            }
+        }
+        if (ranged && step >= from && step <= to) err = write_frame(out, step, maze, current);
+        // Past the range there's nothing left to render
+        if (ranged && step >= to) break;
+    }
+    if (!err && !ranged) err = write_final(out, format, &trace, maze);
+
+    clean_maze(maze);
+    close_trace_file(&trace);
+    return err;
+}
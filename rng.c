@@ -0,0 +1,64 @@
+#include "rng.h"
+
+static uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+// splitmix64, used to spread a single seed over the whole state
+static uint64_t splitmix64(uint64_t* x) {
+    uint64_t z = (*x += 0x9e3779b97f4a7c15u);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9u;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebu;
+    return z ^ (z >> 31);
+}
+
+void rng_seed(struct rng* rng, uint64_t seed) {
+    for (int i = 0; i < 4; i++) rng->s[i] = splitmix64(&seed);
+}
+
+uint64_t rng_next(struct rng* rng) {
+    uint64_t* s = rng->s;
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+
+    return result;
+}
+
+uint64_t rng_below(struct rng* rng, uint64_t bound) {
+    if (bound <= UINT32_MAX) {
+        // Lemire's multiply and shift, rejecting the few values that would
+        // make the result biased
+        uint32_t bound32 = (uint32_t) bound;
+        uint64_t m = (rng_next(rng) >> 32) * bound32;
+        if ((uint32_t) m < bound32) {
+            uint32_t threshold = (uint32_t)(-bound32) % bound32;
+            while ((uint32_t) m < threshold) m = (rng_next(rng) >> 32) * bound32;
+        }
+        return m >> 32;
+    }
+
+    // Huge bounds are rare enough that a division doesn't matter
+    uint64_t threshold = -bound % bound;
+    uint64_t x;
+    do {
+        x = rng_next(rng);
+    } while (x < threshold);
+    return x % bound;
+}
+
+// A slight modification of `djb2` (credit to http://www.cse.yorku.ca/~oz/hash.html)
+uint64_t rng_hash_string(const char* str) {
+    uint64_t hash = 5381;
+    unsigned char c;
+    while ((c = (unsigned char) *str++)) {
+        hash = ((hash << 5) + hash) ^ c;
+    }
+    return hash;
+}
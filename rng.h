@@ -0,0 +1,38 @@
+#ifndef MAZE_GEN_RNG_H
+#define MAZE_GEN_RNG_H
+
+#include <stdint.h> // uint64_t
+
+/**
+ * Random number generator state
+ *
+ * xoshiro256** (https://prng.di.unimi.it/), so a given seed produces the same
+ * numbers on every platform. Each generator is independent, so different
+ * threads can use different generators without locking.
+ */
+struct rng {
+    uint64_t s[4];
+};
+
+/**
+ * Seed a generator
+ */
+void rng_seed(struct rng* rng, uint64_t seed);
+
+/**
+ * Get the next 64 random bits
+ */
+uint64_t rng_next(struct rng* rng);
+
+/**
+ * Get a uniformly distributed number in [0, bound)
+ * bound must be positive.
+ */
+uint64_t rng_below(struct rng* rng, uint64_t bound);
+
+/**
+ * Hash a string to a seed, so mazes can be seeded with words
+ */
+uint64_t rng_hash_string(const char* str);
+
+#endif
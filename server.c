@@ -0,0 +1,218 @@
+#define _POSIX_C_SOURCE 200809L // getline(), fdopen()
+
+#include "server.h"
+#include "algorithms.h"
+#include "generator.h"
+#include "maze_writer.h"
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h> // malloc(), free(), strtoul()
+#include <string.h> // strcmp(), strncmp(), strlen()
+#include <sys/socket.h>
+#include <sys/stat.h> // lstat()
+#include <sys/un.h>
+#include <time.h>   // nanosleep()
+#include <unistd.h> // write(), close(), unlink()
+
+// How long to wait before accepting again after running out of something,
+// doubling each time it happens in a row
+#define MIN_BACKOFF_MS 10
+#define MAX_BACKOFF_MS 1000
+
+// Write all of `buf`, however many calls it takes
+static int write_all(int fd, const char* buf, size_t len) {
+    while (len > 0) {
+        ssize_t written = write(fd, buf, len);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return 1;
+        }
+        buf += written;
+        len -= (size_t) written;
+    }
+    return 0;
+}
+
+static int send_error(int fd, const char* message) {
+    char line[128];
+    int len = snprintf(line, sizeof(line), "error %s\n", message);
+    return write_all(fd, line, (size_t) len);
+}
+
+static int send_body(int fd, const char* body, size_t len) {
+    char line[32];
+    int header_len = snprintf(line, sizeof(line), "ok %zu\n", len);
+    return write_all(fd, line, (size_t) header_len) || write_all(fd, body, len);
+}
+
+// Parse the next space separated number from `*str`, advancing past it
+static int next_number(char** str, unsigned long* out) {
+    char* endptr;
+    if (**str < '0' || **str > '9') return 1;
+    *out = strtoul(*str, &endptr, 10);
+    if (*endptr != ' ' && *endptr != '\0') return 1;
+    *str = *endptr ? endptr + 1 : endptr;
+    return 0;
+}
+
+/** A client connection, handed to its thread */
+struct connection {
+    int fd;
+    maze_cache_t cache;
+};
+
+/**
+ * Handle a `maze` request, `args` being the line after "maze ", or the line
+ * after the algorithm of a `generate` request
+ *
+ * Return: nonzero if the connection should be dropped
+ */
+static int serve_maze(int fd, maze_cache_t cache, const struct maze_algorithm* algorithm, char* args) {
+    unsigned long rows, cols, limit;
+    if (next_number(&args, &rows) || rows < 1) return send_error(fd, "rows must be a positive integer");
+    if (next_number(&args, &cols) || cols < 1) return send_error(fd, "cols must be a positive integer");
+    if (next_number(&args, &limit)) return send_error(fd, "path_len must be a non-negative integer");
+    unsigned long dims_array[] = { rows, cols }, cells;
+    if (maze_cell_count(2, dims_array, &cells) || cells > MAZE_SERVE_MAX_CELLS) {
+        char message[64];
+        snprintf(message, sizeof(message), "rows * cols must be at most %lu", MAZE_SERVE_MAX_CELLS);
+        return send_error(fd, message);
+    }
+
+    char* format = args;
+    char* seed_str = strchr(args, ' ');
+    if (seed_str) *seed_str++ = '\0';
+    if (!maze_format_valid(format)) return send_error(fd, "invalid format");
+
+    char* out;
+    size_t len;
+    int err = cached_maze(cache, algorithm, rows, cols, limit, seed_str, format, &out, &len);
+    if (err == MAZE_CACHED_ERR_MEMORY) return send_error(fd, "not enough memory for the maze");
+    if (err) return send_error(fd, "failed to encode maze");
+
+    err = send_body(fd, out, len);
+    free(out);
+    return err;
+}
+
+// Send a space separated list, one per line
+static int serve_list(int fd, const char* list) {
+    size_t len = strlen(list);
+    char* lines = malloc(len + 2);
+    if (!lines) return send_error(fd, "not enough memory");
+    for (size_t i = 0; i < len; i++) lines[i] = list[i] == ' ' ? '\n' : list[i];
+    lines[len] = '\n';
+    lines[len + 1] = '\0';
+    int err = send_body(fd, lines, len + 1);
+    free(lines);
+    return err;
+}
+
+// Handle a `generate` request, `args` being the line after "generate "
+static int serve_generate(int fd, maze_cache_t cache, char* args) {
+    char* rest = strchr(args, ' ');
+    if (!rest) return send_error(fd, "missing rows");
+    *rest++ = '\0';
+    const struct maze_algorithm* algorithm = find_maze_algorithm(args);
+    if (!algorithm) return send_error(fd, "invalid algorithm");
+    return serve_maze(fd, cache, algorithm, rest);
+}
+
+// Serve requests on a connection until it's closed. Runs on its own thread.
+static void* serve_connection(void* arg) {
+    struct connection* conn = arg;
+    int fd = conn->fd;
+    FILE* in = fdopen(dup(fd), "r");
+    char* line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+
+    while (in && (len = getline(&line, &cap, in)) > 0) {
+        if (line[len - 1] == '\n') line[--len] = '\0';
+
+        int err;
+        if (strncmp(line, "maze ", 5) == 0) {
+            err = serve_maze(fd, conn->cache, find_maze_algorithm(MAZE_DEFAULT_ALGORITHM), line + 5);
+        } else if (strncmp(line, "generate ", 9) == 0) {
+            err = serve_generate(fd, conn->cache, line + 9);
+        } else if (strcmp(line, "formats") == 0) {
+            err = serve_list(fd, MAZE_FORMATS);
+        } else if (strcmp(line, "algorithms") == 0) {
+            err = serve_list(fd, MAZE_ALGORITHMS);
+        } else {
+            err = send_error(fd, "unknown request");
+        }
+        if (err) break;
+    }
+
+    free(line);
+    if (in) fclose(in);
+    close(fd);
+    free(conn);
+    return NULL;
+}
+
+int serve(const char* path, maze_cache_t cache) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Error: socket path `%s` is too long\n", path);
+        return 1;
+    }
+    strcpy(addr.sun_path, path);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        perror("Error: couldn't create socket");
+        return 1;
+    }
+    // Only replace a socket, not a file the path was mistyped onto
+    struct stat st;
+    if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path);
+    if (bind(listener, (struct sockaddr*) &addr, sizeof(addr)) || listen(listener, SOMAXCONN)) {
+        fprintf(stderr, "Error: couldn't listen on `%s`: %s\n", path, strerror(errno));
+        close(listener);
+        return 1;
+    }
+
+    // A client hanging up mid response shouldn't kill the server
+    signal(SIGPIPE, SIG_IGN);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    long backoff_ms = 0;
+    for (;;) {
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            perror("Error: accept failed");
+            if (errno != EMFILE && errno != ENFILE && errno != ENOBUFS && errno != ENOMEM) break;
+            // Out of something connections need, so give them time to close
+            backoff_ms = backoff_ms ? backoff_ms * 2 : MIN_BACKOFF_MS;
+            if (backoff_ms > MAX_BACKOFF_MS) backoff_ms = MAX_BACKOFF_MS;
+            struct timespec wait = { backoff_ms / 1000, backoff_ms % 1000 * 1000000 };
+            nanosleep(&wait, NULL);
+            continue;
+        }
+        backoff_ms = 0;
+        struct connection* conn = malloc(sizeof(struct connection));
+        if (!conn) {
+            close(fd);
+            continue;
+        }
+        conn->fd = fd;
+        conn->cache = cache;
+        pthread_t thread;
+        if (pthread_create(&thread, &attr, serve_connection, conn)) {
+            close(fd);
+            free(conn);
+        }
+    }
+    pthread_attr_destroy(&attr);
+    close(listener);
+    return 1;
+}
@@ -0,0 +1,47 @@
+#ifndef MAZE_GEN_SERVER_H
+#define MAZE_GEN_SERVER_H
+
+#include "cache.h"
+
+/*
+ * A long lived maze server on a Unix socket
+ *
+ * Generating a maze in an already running process skips process start up and
+ * temporary files, which dominate the time taken for small mazes. Clients can
+ * keep a connection open and send any number of requests on it, one at a
+ * time. Each connection is served by its own thread.
+ *
+ * Requests are a single line:
+ *
+ *     maze <rows> <cols> <path_len> <format> [<seed>]
+ *     generate <algorithm> <rows> <cols> <path_len> <format> [<seed>]
+ *     formats
+ *     algorithms
+ *
+ * `maze` generates with the default algorithm, `generate` with any of
+ * `MAZE_ALGORITHMS` that makes two dimensional mazes. The seed is the rest of
+ * the line after the format, and may contain spaces.
+ * Without a seed, the current time is used, like the `--seed` flag. Only
+ * seeded mazes are cached.
+ *
+ * Responses start with a line, then maybe a body:
+ *
+ *     ok <length>         followed by `length` bytes, the encoded maze, or
+ *                         the valid formats or algorithms one per line
+ *     error <message>     the request was bad, the connection stays open
+ */
+
+/**
+ * Listen on the Unix socket at `path` and serve requests until killed
+ * A socket already at `path`, such as one left by a server that died, is
+ * replaced, but anything else there is left alone and the server doesn't
+ * start. If `cache` isn't NULL, seeded mazes are looked up in and stored to
+ * it. Running out of file descriptors or memory for a connection backs off
+ * rather than spinning.
+ *
+ * Return: nonzero if the socket couldn't be set up, or if accepting
+ *   connections failed for good, otherwise doesn't return
+ */
+int serve(const char* path, maze_cache_t cache);
+
+#endif
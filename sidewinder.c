@@ -0,0 +1,54 @@
+#include "sidewinder.h"
+#include "raster.h"
+#include "stats.h"
+#include <stdlib.h> // malloc(), free()
+
+struct sidewinder {
+    unsigned long rows;
+    unsigned long cols;
+    unsigned long row; // how many rows have been generated
+    struct rng* rng;
+};
+
+struct sidewinder* new_sidewinder(unsigned long rows, unsigned long cols, struct rng* rng) {
+    struct sidewinder* sidewinder = stats_malloc(sizeof(struct sidewinder));
+    sidewinder->rows = rows;
+    sidewinder->cols = cols;
+    sidewinder->row = 0;
+    sidewinder->rng = rng;
+    return sidewinder;
+}
+
+int sidewinder_next_row(void* ctx, unsigned char* row) {
+    struct sidewinder* sidewinder = ctx;
+    if (sidewinder->row >= sidewinder->rows) return 1;
+    STATS_PHASE_START(timer);
+    unsigned long cols = sidewinder->cols;
+    int last = sidewinder->row + 1 == sidewinder->rows;
+
+    unsigned long run_start = 0;
+    uint64_t bits = 0;
+    for (unsigned long c = 0; c < cols; c++) {
+        if (c % 64 == 0) bits = rng_next(sidewinder->rng);
+        row[c] = ROW_VISITED;
+        // The last row can't go south, so it's one run all the way across
+        int end_run = c + 1 == cols || (!last && (bits & 1));
+        bits >>= 1;
+        if (!end_run) {
+            row[c] |= ROW_EAST;
+        } else if (!last) {
+            unsigned long south = run_start + (unsigned long) rng_below(sidewinder->rng, c - run_start + 1);
+            row[south] |= ROW_SOUTH;
+            run_start = c + 1;
+        }
+    }
+
+    sidewinder->row++;
+    STATS_SEARCH(0, cols);
+    STATS_PHASE_END(MAZE_PHASE_CARVE, timer);
+    return 0;
+}
+
+void sidewinder_deallocate(struct sidewinder* sidewinder) {
+    stats_free(sidewinder);
+}
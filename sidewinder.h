@@ -0,0 +1,35 @@
+#ifndef MAZE_GEN_SIDEWINDER_H
+#define MAZE_GEN_SIDEWINDER_H
+
+#include "rng.h"
+
+/**
+ * Generates a two dimensional maze a row at a time, with the sidewinder
+ * algorithm
+ *
+ * Each row is split into runs of cells joined east to west, and every run
+ * opens a single passage south from a random cell in it. The bottom row is
+ * one long run. Only the current run is kept, so memory use doesn't depend on
+ * the size of the maze at all.
+ */
+typedef struct sidewinder* sidewinder_t;
+
+/**
+ * Instantiate a new generator for a `rows` by `cols` maze
+ * rng is the source of randomness, and must outlive the generator.
+ */
+sidewinder_t new_sidewinder(unsigned long rows, unsigned long cols, struct rng* rng);
+
+/**
+ * Generate the next row, like `eller_next_row()`
+ *
+ * Return: 0 on success, nonzero if every row has already been generated
+ */
+int sidewinder_next_row(void* sidewinder, unsigned char* row);
+
+/**
+ * Free the generator
+ */
+void sidewinder_deallocate(sidewinder_t sidewinder);
+
+#endif
@@ -0,0 +1,264 @@
+#define _POSIX_C_SOURCE 200112L // mmap(), fstat()
+
+#include <img.h>
+#include <fcntl.h>    // open()
+#include <stdio.h>
+#include <stdlib.h>   // strtoul(), free()
+#include <string.h>   // strncmp(), memcmp()
+#include <sys/mman.h> // mmap(), munmap()
+#include <sys/stat.h> // fstat()
+#include <unistd.h>   // close()
+
+#include "generator.h"
+#include "maze_writer.h"
+#include "mazefile.h"
+#include "raster.h"
+#include "solve.h"
+#include "text-format.h"
+
+static const char* usage =
+    "Usage: solve-maze input output [--from row,col] [--to row,col] [--format {png|text}]\n"
+    "\n"
+    "Find the path through a maze and draw it in. The input can be a text, png\n"
+    "or binary maze. The path goes from the top left corner to the bottom right\n"
+    "one unless --from or --to say otherwise. An output of - writes to stdout.\n";
+
+/**
+ * Tells whether the character at `x`, `y` of a rasterized maze is open
+ * Coordinates are in the lines of `raster.h`, so cells are at odd `x` and `y`.
+ */
+typedef int (*open_func_t)(const void* ctx, size_t y, size_t x);
+
+/** Build a grid maze from a rasterized one, or return NULL if it's too big */
+static struct maze* from_raster(unsigned long rows, unsigned long cols, open_func_t is_open, const void* ctx) {
+    unsigned long dims_array[] = { rows, cols };
+    struct maze* maze = alloc_grid(2, dims_array);
+    if (!maze) return NULL;
+    grid_cell_t* grid = maze->grid;
+    for (unsigned long r = 0; r < rows; r++) {
+        for (unsigned long c = 0; c < cols; c++) {
+            unsigned long index = r * cols + c;
+            grid[index] |= GRID_VISITED;
+            if (c + 1 < cols && is_open(ctx, 2 * r + 1, 2 * c + 2)) {
+                grid[index] |= GRID_PASSAGE(DIR_PLUS(1));
+                grid[index + 1] |= GRID_PASSAGE(DIR_MINUS(1));
+            }
+            if (r + 1 < rows && is_open(ctx, 2 * r + 2, 2 * c + 1)) {
+                grid[index] |= GRID_PASSAGE(DIR_PLUS(0));
+                grid[index + cols] |= GRID_PASSAGE(DIR_MINUS(0));
+            }
+        }
+    }
+    return maze;
+}
+
+/** A text maze mapped into memory. Every line is `width` characters and a newline. */
+struct text_maze {
+    const char* text;
+    size_t width;
+};
+
+static int text_open(const void* ctx, size_t y, size_t x) {
+    const struct text_maze* text = ctx;
+    return text->text[y * (text->width + 1) + x] != WALL;
+}
+
+static int png_open(const void* ctx, size_t y, size_t x) {
+    const struct img* img = ctx;
+    struct pixel p = img->rows[y][x];
+    // Walls are black. Anything else is a space, or a path drawn in already.
+    return p.red != 0 || p.green != 0 || p.blue != 0;
+}
+
+// Read the walls of a binary maze, the same way `from_raster()` does
+static struct maze* from_bin(const struct maze_file* file) {
+    unsigned long rows = file->dims_array[0], cols = file->dims_array[1];
+    unsigned long dims_array[] = { rows, cols };
+    struct maze* maze = alloc_grid(2, dims_array);
+    if (!maze) return NULL;
+    grid_cell_t* grid = maze->grid;
+    for (unsigned long i = 0; i < maze->size; i++) {
+        unsigned walls = maze_file_walls(file, i);
+        grid[i] |= GRID_VISITED;
+        if (!(walls & 2u) && (i + 1) % cols != 0) {
+            grid[i] |= GRID_PASSAGE(DIR_PLUS(1));
+            grid[i + 1] |= GRID_PASSAGE(DIR_MINUS(1));
+        }
+        if (!(walls & 1u) && i + cols < maze->size) {
+            grid[i] |= GRID_PASSAGE(DIR_PLUS(0));
+            grid[i + cols] |= GRID_PASSAGE(DIR_MINUS(0));
+        }
+    }
+    return maze;
+}
+
+/**
+ * Load a text maze
+ *
+ * Return: The maze, or NULL if `path` isn't a text maze, or if it's too big,
+ *   when `too_big` is set
+ */
+static struct maze* load_text(const char* path, int* too_big) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+    size_t length = (size_t) st.st_size;
+    char* text = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (text == MAP_FAILED) return NULL;
+
+    // Every line must be as long as the first, and end in a newline
+    struct maze* maze = NULL;
+    const char* newline = memchr(text, '\n', length);
+    size_t width = newline ? (size_t)(newline - text) : 0;
+    size_t height = width ? length / (width + 1) : 0;
+    int valid = width >= 3 && width % 2 == 1 && height >= 3 && height % 2 == 1 && length == height * (width + 1);
+    for (size_t y = 0; y < height && valid; y++) valid = text[y * (width + 1) + width] == '\n';
+    if (valid) {
+        struct text_maze text_maze = { text, width };
+        maze = from_raster((height - 1) / 2, (width - 1) / 2, text_open, &text_maze);
+        *too_big = !maze;
+    }
+    munmap(text, length);
+    return maze;
+}
+
+/**
+ * Load a png maze
+ *
+ * Return: The maze, or NULL if `path` isn't a png maze, or if it's too big,
+ *   when `too_big` is set
+ */
+static struct maze* load_png(const char* path, int* too_big) {
+    struct img img;
+    if (readpng(path, &img) != 0) return NULL;
+
+    struct maze* maze = NULL;
+    if (img.width >= 3 && img.width % 2 == 1 && img.height >= 3 && img.height % 2 == 1) {
+        maze = from_raster((unsigned long)(img.height - 1) / 2, (unsigned long)(img.width - 1) / 2, png_open, &img);
+        *too_big = !maze;
+    }
+    for (int r = 0; r < img.height; r++) free(img.rows[r]);
+    free(img.rows);
+    return maze;
+}
+
+/** Whether the file at `path` starts with the png signature */
+static int is_png(const char* path) {
+    static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    unsigned char start[8];
+    FILE* file = fopen(path, "rb");
+    if (!file) return 0;
+    int png = fread(start, 1, 8, file) == 8 && memcmp(start, signature, 8) == 0;
+    fclose(file);
+    return png;
+}
+
+/** Parse a cell given as "row,col" */
+static int parse_cell(const char* str, unsigned long* cell) {
+    char* endptr;
+    if (*str < '0' || *str > '9') return 1;
+    cell[0] = strtoul(str, &endptr, 10);
+    if (*endptr != ',' || endptr[1] < '0' || endptr[1] > '9') return 1;
+    cell[1] = strtoul(endptr + 1, &endptr, 10);
+    return *endptr != '\0';
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3 || strncmp(argv[1], "-h", 2) == 0) {
+        fprintf(argc < 3 ? stderr : stdout, "%s", usage);
+        return argc < 3 ? 2 : 0;
+    }
+    const char* in_path = argv[1];
+    const char* out_path = argv[2];
+    const char* format = "png";
+    unsigned long from[2] = { 0, 0 }, to[2] = { NO_CELL, NO_CELL };
+
+    for (int i = 3; i < argc; i++) {
+        if (i == argc - 1) {
+            fprintf(stderr, "Error: Missing argument for %s.\n", argv[i]);
+            return 2;
+        } else if (strncmp(argv[i], "--from", 7) == 0 || strncmp(argv[i], "--to", 5) == 0) {
+            if (parse_cell(argv[i + 1], argv[i][2] == 'f' ? from : to)) {
+                fprintf(stderr, "Error: `%s` is not a valid argument for %s (must be row,col)\n", argv[i + 1], argv[i]);
+                return 2;
+            }
+            i++;
+        } else if (strncmp(argv[i], "--format", 9) == 0) {
+            format = argv[++i];
+            if (strcmp(format, "png") != 0 && strcmp(format, "text") != 0) {
+                fprintf(stderr, "Error: `%s` isn't a valid output format.\n", format);
+                return 2;
+            }
+        } else {
+            fprintf(stderr, "Error: `%s` isn't a flag.\n", argv[i]);
+            return 2;
+        }
+    }
+
+    // Binary mazes are recognized by their header, pngs by their signature,
+    // and anything else had better be text
+    struct maze* maze = NULL;
+    int too_big = 0;
+    struct maze_file file;
+    int status = open_maze_file(in_path, &file);
+    if (status == 0) {
+        if (file.dims == 2) {
+            maze = from_bin(&file);
+            too_big = !maze;
+        }
+        close_maze_file(&file);
+    } else if (status == MAZEFILE_ERR_OPEN) {
+        fprintf(stderr, "Error: couldn't open `%s`\n", in_path);
+        return 1;
+    } else if (status == MAZEFILE_ERR_CORRUPT) {
+        fprintf(stderr, "Error: `%s` is a corrupt binary maze\n", in_path);
+        return 1;
+    } else if (is_png(in_path)) {
+        maze = load_png(in_path, &too_big);
+    } else {
+        maze = load_text(in_path, &too_big);
+    }
+    if (too_big) {
+        fprintf(stderr, "Error: not enough memory for a maze that big\n");
+        return 1;
+    }
+    if (!maze) {
+        fprintf(stderr, "Error: `%s` isn't a two dimensional maze\n", in_path);
+        return 1;
+    }
+
+    unsigned long rows = maze->dims_array[0], cols = maze->dims_array[1];
+    if (to[0] == NO_CELL) {
+        to[0] = rows - 1;
+        to[1] = cols - 1;
+    }
+    if (from[0] >= rows || from[1] >= cols || to[0] >= rows || to[1] >= cols) {
+        fprintf(stderr, "Error: the cells to solve between must be inside the %lux%lu maze\n", rows, cols);
+        clean_maze(maze);
+        return 2;
+    }
+
+    struct maze_solution* solution = solve_maze(maze, cell_index(maze, from), cell_index(maze, to));
+    if (!solution) {
+        fprintf(stderr, "Error: there's no path between %lu,%lu and %lu,%lu\n", from[0], from[1], to[0], to[1]);
+        clean_maze(maze);
+        return 1;
+    }
+
+    int err = 1;
+    int to_stdout = strcmp(out_path, "-") == 0;
+    FILE* out = to_stdout ? stdout : fopen(out_path, "wb");
+    if (out) {
+        err = write_solved_maze(out, maze, solution, format);
+        err = (to_stdout ? fflush(out) : fclose(out)) || err;
+    }
+    if (err) fprintf(stderr, "Error: failed to write `%s`\n", out_path);
+    solution_deallocate(solution);
+    clean_maze(maze);
+    return err;
+}
@@ -0,0 +1,105 @@
+#include "solve.h"
+#include "stats.h"
+#include <stdlib.h> // malloc(), calloc(), free()
+#include <string.h> // memcpy()
+
+// Marks the cell the search started from, which wasn't reached from anywhere
+#define FROM_START 0xFF
+
+/* A growable ring of cells waiting to be searched from */
+struct frontier {
+    unsigned long* cells;
+    size_t cap;
+    size_t head; // next to pop
+    size_t size;
+};
+
+static void frontier_push(struct frontier* frontier, unsigned long cell) {
+    if (frontier->size == frontier->cap) {
+        // Unwrap into a ring twice the size
+        unsigned long* cells = stats_malloc(2 * frontier->cap * sizeof(unsigned long));
+        size_t first = frontier->cap - frontier->head;
+        memcpy(cells, frontier->cells + frontier->head, first * sizeof(unsigned long));
+        memcpy(cells + first, frontier->cells, frontier->head * sizeof(unsigned long));
+        stats_free(frontier->cells);
+        frontier->cells = cells;
+        frontier->cap *= 2;
+        frontier->head = 0;
+    }
+    frontier->cells[(frontier->head + frontier->size++) % frontier->cap] = cell;
+}
+
+static unsigned long frontier_pop(struct frontier* frontier) {
+    unsigned long cell = frontier->cells[frontier->head];
+    frontier->head = (frontier->head + 1) % frontier->cap;
+    frontier->size--;
+    return cell;
+}
+
+// Find the neighbor through an open passage in direction `dir`, if there is one
+static int open_neighbor(const struct maze* maze, unsigned long index, unsigned dir, unsigned long* neigh) {
+    if (maze->grid) {
+        // Passages never lead outside the maze, so no bounds checks are needed
+        if (!(maze->grid[index] & GRID_PASSAGE(dir))) return 0;
+        unsigned long stride = maze->strides[dir / 2];
+        *neigh = dir == DIR_PLUS(dir / 2) ? index + stride : index - stride;
+        return 1;
+    }
+    return maze_passage(maze, index, dir) && maze_neighbor(maze, index, dir, neigh);
+}
+
+struct maze_solution* solve_maze(const struct maze* maze, unsigned long from, unsigned long to) {
+    if (from >= maze->size || to >= maze->size) return NULL;
+    STATS_PHASE_START(timer);
+
+    // The direction back towards `from` of every cell reached, plus one so 0
+    // means unreached
+    unsigned char* back = stats_calloc(maze->size, 1);
+    struct frontier frontier = { stats_malloc(1024 * sizeof(unsigned long)), 1024, 0, 0 };
+    unsigned dirs = 2 * maze->dims;
+
+    back[from] = FROM_START;
+    frontier_push(&frontier, from);
+    while (frontier.size > 0 && !back[to]) {
+        unsigned long cell = frontier_pop(&frontier);
+        for (unsigned dir = 0; dir < dirs; dir++) {
+            unsigned long neigh;
+            if (open_neighbor(maze, cell, dir, &neigh) && !back[neigh]) {
+                back[neigh] = (unsigned char)(DIR_OPPOSITE(dir) + 1);
+                frontier_push(&frontier, neigh);
+            }
+        }
+    }
+    stats_free(frontier.cells);
+
+    struct maze_solution* solution = NULL;
+    if (back[to]) {
+        solution = stats_malloc(sizeof(struct maze_solution));
+        solution->from = from;
+        solution->to = to;
+        solution->length = 1;
+        solution->on_path = stats_calloc((maze->size + 63) / 64, sizeof(uint64_t));
+
+        // Walk back from the end
+        unsigned long cell = to;
+        solution->on_path[cell / 64] |= (uint64_t) 1 << (cell % 64);
+        while (cell != from) {
+            maze_neighbor(maze, cell, back[cell] - 1u, &cell);
+            solution->on_path[cell / 64] |= (uint64_t) 1 << (cell % 64);
+            solution->length++;
+        }
+    }
+
+    stats_free(back);
+    STATS_PHASE_END(MAZE_PHASE_SOLVE, timer);
+    return solution;
+}
+
+int solution_has(const struct maze_solution* solution, unsigned long index) {
+    return (int)((solution->on_path[index / 64] >> (index % 64)) & 1);
+}
+
+void solution_deallocate(struct maze_solution* solution) {
+    stats_free(solution->on_path);
+    stats_free(solution);
+}
@@ -0,0 +1,45 @@
+#ifndef MAZE_GEN_SOLVE_H
+#define MAZE_GEN_SOLVE_H
+
+#include "generator.h"
+#include <stdint.h> // uint64_t
+
+/**
+ * The path between two cells of a maze
+ *
+ * Cells on the path are kept as a bitset over the maze's cells, so writers
+ * can check any cell in constant time without holding the path in order.
+ */
+struct maze_solution {
+    /** The ends of the path */
+    unsigned long from;
+    unsigned long to;
+    /** Cells on the path, including both ends */
+    unsigned long length;
+    /** Bit `i % 64` of word `i / 64` is set if cell `i` is on the path */
+    uint64_t* on_path;
+};
+
+/**
+ * Find the path between two cells by breadth first search
+ *
+ * Works on grid and linked mazes of any number of dimensions. The search
+ * keeps a byte per cell, the direction back to the cell it was reached from,
+ * and a queue of the frontier, and stops as soon as it reaches `to`.
+ *
+ * Return: The path, or NULL if there isn't one. Free with
+ *   `solution_deallocate()`
+ */
+struct maze_solution* solve_maze(const struct maze* maze, unsigned long from, unsigned long to);
+
+/**
+ * Check whether the cell at `index` is on the path
+ */
+int solution_has(const struct maze_solution* solution, unsigned long index);
+
+/**
+ * Free a solution
+ */
+void solution_deallocate(struct maze_solution* solution);
+
+#endif
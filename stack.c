@@ -1,33 +1,59 @@
+#include "stack.h"
+#include "stats.h"
 #include <stdlib.h> // malloc(), calloc, free(), NULL
 
 /* A stack node */
-typedef struct stack {
+struct stack {
     void* data;         // data stored in this node
     struct stack* next; // next node in the stack. NULL if this is the last one
-}** stack_t;
+};
+
+/* Metadata for a stack */
+struct stack_meta {
+    struct stack* top; // the top of the stack. NULL if the stack is empty
+    pool_t pool;       // where nodes come from. NULL to use malloc()
+};
 
 stack_t new_stack(void) {
-    stack_t stack = calloc(1, sizeof(struct stack));
-    *stack = NULL;
+    return new_stack_pool(NULL);
+}
+
+stack_t new_stack_pool(pool_t pool) {
+    stack_t stack = stats_calloc(1, sizeof(struct stack_meta));
+    stack->top = NULL;
+    stack->pool = pool;
     return stack;
 }
 
+size_t stack_node_size(void) {
+    return sizeof(struct stack);
+}
+
+// Release a node to wherever it came from
+static void free_node(stack_t stack, struct stack* node) {
+    if (stack->pool) {
+        pool_free(stack->pool, node);
+    } else {
+        stats_free(node);
+    }
+}
+
 void stack_deallocate(stack_t stack) {
-    while (*stack != NULL) {
-        struct stack* current = *stack;
-        *stack = current->next;
-        free(current);
+    while (stack->top != NULL) {
+        struct stack* current = stack->top;
+        stack->top = current->next;
+        free_node(stack, current);
     }
-    free(stack);
+    stats_free(stack);
 }
 
 // if the stack is empty, returns a null pointer
 void* stack_pop(stack_t stack) {
-    if (*stack != NULL) {
-        struct stack* old = *stack;
+    if (stack->top != NULL) {
+        struct stack* old = stack->top;
         void* data = old->data;
-        *stack = old->next;
-        free(old);
+        stack->top = old->next;
+        free_node(stack, old);
         return data;
     }
 
@@ -35,15 +61,20 @@ void* stack_pop(stack_t stack) {
 }
 
 void stack_push(stack_t stack, void* data) {
-    struct stack* next = malloc(sizeof(struct stack));
+    struct stack* next;
+    if (stack->pool) {
+        next = pool_alloc(stack->pool);
+    } else {
+        next = stats_malloc(sizeof(struct stack));
+    }
     next->data = data;
-    next->next = *stack;
-    *stack = next;
+    next->next = stack->top;
+    stack->top = next;
 }
 
 // Return 1 if there is something on the stack, 0 otherwise
 int stack_peek(stack_t stack) {
-    if (*stack != NULL) {
+    if (stack->top != NULL) {
         return 1;
     } else {
         return 0;
@@ -1,13 +1,26 @@
 #ifndef MAZE_GEN_STACK_H
 #define MAZE_GEN_STACK_H
 
-typedef struct stack** stack_t;
+#include "pool.h"
+
+typedef struct stack_meta* stack_t;
 
 /**
  * Instantiate and prep a new stack
  */
 stack_t new_stack(void);
 
+/**
+ * Instantiate and prep a new stack that takes its nodes from `pool`
+ * The pool must have been created with `stack_node_size()`.
+ */
+stack_t new_stack_pool(pool_t pool);
+
+/**
+ * The size of a stack node, for creating a pool with `new_pool()`
+ */
+size_t stack_node_size(void);
+
 /**
  * Free all the stack resources
  * Note that this won't mangle or free the data that had been in the stack.
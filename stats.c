@@ -0,0 +1,109 @@
+#define _POSIX_C_SOURCE 200809L // clock_gettime()
+
+#include "stats.h"
+#include <inttypes.h> // PRIu64
+#include <stdlib.h>   // malloc(), calloc(), realloc(), free()
+#include <string.h>   // memset()
+#include <time.h>
+
+static const char* phase_names[MAZE_PHASES] = {
+    "alloc", "link", "carve", "solve", "encode", "write", "cache",
+};
+
+// Thread local, so threads generating mazes side by side each get their own
+static __thread struct maze_stats* attached;
+
+void maze_stats_attach(struct maze_stats* stats) {
+    if (stats) memset(stats, 0, sizeof(struct maze_stats));
+    attached = stats;
+}
+
+void maze_stats_add(struct maze_stats* total, const struct maze_stats* stats) {
+    for (int p = 0; p < MAZE_PHASES; p++) total->seconds[p] += stats->seconds[p];
+    total->allocs += stats->allocs;
+    total->alloc_bytes += stats->alloc_bytes;
+    total->frees += stats->frees;
+    if (stats->peak_depth > total->peak_depth) total->peak_depth = stats->peak_depth;
+    total->visited += stats->visited;
+}
+
+void maze_stats_print(FILE* file, const struct maze_stats* stats) {
+    double total = 0;
+    fprintf(file, "{\"phases_s\": {");
+    for (int p = 0; p < MAZE_PHASES; p++) {
+        fprintf(file, "%s\"%s\": %.6f", p ? ", " : "", phase_names[p], stats->seconds[p]);
+        total += stats->seconds[p];
+    }
+    fprintf(file, "}, \"total_s\": %.6f, \"allocs\": %" PRIu64 ", \"alloc_bytes\": %" PRIu64
+            ", \"frees\": %" PRIu64 ", \"peak_depth\": %" PRIu64 ", \"visited\": %" PRIu64 "}\n",
+            total, stats->allocs, stats->alloc_bytes, stats->frees, stats->peak_depth, stats->visited);
+}
+
+#ifndef MAZE_NO_STATS
+
+// Skips the clock when nothing is attached, as the time won't be used
+double maze_stats_now(void) {
+    if (!attached) return 0;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec + (double) now.tv_nsec / 1e9;
+}
+
+void maze_stats_phase(enum maze_phase phase, double start) {
+    if (attached) attached->seconds[phase] += maze_stats_now() - start;
+}
+
+void maze_stats_alloc(size_t bytes) {
+    if (!attached) return;
+    attached->allocs++;
+    attached->alloc_bytes += bytes;
+}
+
+void maze_stats_free(void) {
+    if (attached) attached->frees++;
+}
+
+// Unlike maze_stats_attach(), these leave what was recorded alone
+struct maze_stats* maze_stats_pause(void) {
+    struct maze_stats* stats = attached;
+    attached = NULL;
+    return stats;
+}
+
+void maze_stats_resume(struct maze_stats* stats) {
+    attached = stats;
+}
+
+void* stats_malloc(size_t size) {
+    void* ptr = malloc(size);
+    if (ptr) maze_stats_alloc(size);
+    return ptr;
+}
+
+void* stats_calloc(size_t count, size_t size) {
+    void* ptr = calloc(count, size);
+    if (ptr) maze_stats_alloc(count * size);
+    return ptr;
+}
+
+void* stats_realloc(void* ptr, size_t size) {
+    void* moved = realloc(ptr, size);
+    if (moved) {
+        if (ptr) maze_stats_free();
+        maze_stats_alloc(size);
+    }
+    return moved;
+}
+
+void stats_free(void* ptr) {
+    if (ptr) maze_stats_free();
+    free(ptr);
+}
+
+void maze_stats_search(uint64_t peak_depth, uint64_t visited) {
+    if (!attached) return;
+    if (peak_depth > attached->peak_depth) attached->peak_depth = peak_depth;
+    attached->visited += visited;
+}
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef MAZE_GEN_STATS_H
+#define MAZE_GEN_STATS_H
+
+#include <stdint.h> // uint64_t
+#include <stdio.h>  // FILE
+#include <stdlib.h> // size_t, malloc() and friends
+
+/**
+ * Instrumentation of maze generation
+ *
+ * Time spent in each phase, allocations made for cells, lists and stacks, and
+ * what the depth first search did are recorded into whichever `struct
+ * maze_stats` is attached to the current thread. Nothing is recorded when none
+ * is attached, so a maze can be generated with and without stats in the same
+ * process.
+ *
+ * The hooks are the macros below, and memory the stats should see is allocated
+ * and freed with `stats_malloc()` and friends, which count as they go.
+ * Building with `-DMAZE_NO_STATS` compiles all of them out, leaving the
+ * allocators as the plain ones. Otherwise the only cost without stats attached is a check for
+ * the attached stats per phase and per allocation; the search counts into
+ * locals and records them once at the end.
+ */
+
+/** Phases of making a maze, timed separately */
+enum maze_phase {
+    MAZE_PHASE_ALLOC,  // allocating the maze
+    MAZE_PHASE_LINK,   // linking and shuffling neighbors, for linked mazes
+    MAZE_PHASE_CARVE,  // carving passages
+    MAZE_PHASE_SOLVE,  // finding the path through the maze
+    MAZE_PHASE_ENCODE, // encoding the maze into its output format
+    MAZE_PHASE_WRITE,  // writing the output
+    MAZE_PHASE_CACHE,  // looking up and storing mazes in the cache
+    MAZE_PHASES,
+};
+
+/** Everything recorded while stats are attached */
+struct maze_stats {
+    /** Seconds spent in each phase, on the monotonic clock */
+    double seconds[MAZE_PHASES];
+    /** Calls to malloc() and friends, and the bytes asked for */
+    uint64_t allocs;
+    uint64_t alloc_bytes;
+    /** Calls to free() */
+    uint64_t frees;
+    /** The deepest the search got from its starting cell */
+    uint64_t peak_depth;
+    /** Cells the search carved into, including the starting cell */
+    uint64_t visited;
+};
+
+/**
+ * Zero `stats` and record into it from this thread, until detached with
+ * `maze_stats_attach(NULL)`
+ * Allocations made on other threads aren't counted.
+ */
+void maze_stats_attach(struct maze_stats* stats);
+
+/**
+ * Add what `stats` recorded to `total`, such as from another thread
+ * Times and counts are summed, and the deepest search kept.
+ */
+void maze_stats_add(struct maze_stats* total, const struct maze_stats* stats);
+
+/**
+ * Write `stats` to `file` as a single line of JSON
+ */
+void maze_stats_print(FILE* file, const struct maze_stats* stats);
+
+#ifdef MAZE_NO_STATS
+
+#define STATS_PHASE_START(timer) ((void) 0)
+#define STATS_PHASE_END(phase, timer) ((void) 0)
+#define STATS_ALLOC(bytes) ((void) 0)
+#define STATS_FREE() ((void) 0)
+#define STATS_SEARCH(peak_depth, visited) ((void) 0)
+#define STATS_PAUSE(saved) ((void) 0)
+#define STATS_RESUME(saved) ((void) 0)
+
+#define stats_malloc(size) malloc(size)
+#define stats_calloc(count, size) calloc(count, size)
+#define stats_realloc(ptr, size) realloc(ptr, size)
+#define stats_free(ptr) free(ptr)
+
+#else
+
+/** Start timing a phase, declaring `timer` to hold the start time */
+#define STATS_PHASE_START(timer) double timer = maze_stats_now()
+/** Add the time since `STATS_PHASE_START(timer)` to `phase` */
+#define STATS_PHASE_END(phase, timer) maze_stats_phase(phase, timer)
+/** Count an allocation of `bytes` */
+#define STATS_ALLOC(bytes) maze_stats_alloc(bytes)
+/** Count a free */
+#define STATS_FREE() maze_stats_free()
+/** Record a finished search */
+#define STATS_SEARCH(peak_depth, visited) maze_stats_search(peak_depth, visited)
+/** Stop recording on this thread, declaring `saved` to hold what was attached */
+#define STATS_PAUSE(saved) struct maze_stats* saved = maze_stats_pause()
+/** Go back to recording into what `STATS_PAUSE(saved)` detached */
+#define STATS_RESUME(saved) maze_stats_resume(saved)
+
+/** `malloc()`, counting the allocation if it succeeds */
+void* stats_malloc(size_t size);
+/** `calloc()`, counting the allocation if it succeeds */
+void* stats_calloc(size_t count, size_t size);
+/** `realloc()`, counting a free of `ptr` and an allocation if it succeeds */
+void* stats_realloc(void* ptr, size_t size);
+/** `free()`, counting it unless `ptr` is NULL */
+void stats_free(void* ptr);
+
+// Used by the macros above, rather than directly
+double maze_stats_now(void);
+void maze_stats_phase(enum maze_phase phase, double start);
+void maze_stats_alloc(size_t bytes);
+void maze_stats_free(void);
+void maze_stats_search(uint64_t peak_depth, uint64_t visited);
+struct maze_stats* maze_stats_pause(void);
+void maze_stats_resume(struct maze_stats* stats);
+
+#endif
+
+#endif
@@ -0,0 +1,109 @@
+#include "tar.h"
+#include <pthread.h>
+#include <string.h> // memset(), memcpy(), strlen()
+#include <time.h>   // time()
+
+#define BLOCK_SIZE 512
+
+// The biggest size the 11 octal digits of the header can hold
+#define MAX_FILE_SIZE 077777777777ull
+
+struct tar_writer {
+    FILE* file;
+    unsigned long long mtime; // every file is stamped with when the archive was started
+    pthread_mutex_t lock;     // protects everything below
+    int failed;
+};
+
+/* A ustar header, every field in ASCII */
+struct tar_header {
+    char name[100];
+    char mode[8];
+    char uid[8];
+    char gid[8];
+    char size[12];
+    char mtime[12];
+    char checksum[8];
+    char type;
+    char linkname[100];
+    char magic[6];
+    char version[2];
+    char uname[32];
+    char gname[32];
+    char devmajor[8];
+    char devminor[8];
+    char prefix[155];
+    char pad[12];
+};
+
+tar_writer_t new_tar_writer(FILE* file) {
+    tar_writer_t tar = malloc(sizeof(struct tar_writer));
+    tar->file = file;
+    tar->mtime = (unsigned long long) time(NULL);
+    tar->failed = 0;
+    pthread_mutex_init(&tar->lock, NULL);
+    return tar;
+}
+
+/**
+ * Fill in the header for a file
+ * Names too long for the name field are split at a '/' into the prefix.
+ *
+ * Return: 0 on success, nonzero if the name or size don't fit
+ */
+static int fill_header(const tar_writer_t tar, struct tar_header* header, const char* name, size_t len) {
+    memset(header, 0, sizeof(struct tar_header));
+    size_t name_len = strlen(name);
+    if (name_len == 0 || name_len > TAR_NAME_MAX || (unsigned long long) len > MAX_FILE_SIZE) return 1;
+    if (name_len <= sizeof(header->name)) {
+        memcpy(header->name, name, name_len);
+    } else {
+        // The first '/' that leaves a short enough name after it
+        size_t split = name_len - sizeof(header->name) - 1;
+        while (split < name_len && name[split] != '/') split++;
+        if (split == name_len || split > sizeof(header->prefix)) return 1;
+        memcpy(header->prefix, name, split);
+        memcpy(header->name, name + split + 1, name_len - split - 1);
+    }
+
+    snprintf(header->mode, sizeof(header->mode), "%07o", 0644);
+    snprintf(header->uid, sizeof(header->uid), "%07o", 0);
+    snprintf(header->gid, sizeof(header->gid), "%07o", 0);
+    snprintf(header->size, sizeof(header->size), "%011llo", (unsigned long long) len);
+    snprintf(header->mtime, sizeof(header->mtime), "%011llo", tar->mtime & MAX_FILE_SIZE);
+    header->type = '0';
+    memcpy(header->magic, "ustar", 6);
+    memcpy(header->version, "00", 2);
+
+    // Summed with the checksum itself as spaces
+    memset(header->checksum, ' ', sizeof(header->checksum));
+    unsigned sum = 0;
+    const unsigned char* bytes = (const unsigned char*) header;
+    for (size_t i = 0; i < sizeof(struct tar_header); i++) sum += bytes[i];
+    snprintf(header->checksum, sizeof(header->checksum), "%06o", sum);
+    header->checksum[7] = ' ';
+    return 0;
+}
+
+int tar_writer_add(tar_writer_t tar, const char* name, const char* data, size_t len) {
+    struct tar_header header;
+    if (fill_header(tar, &header, name, len)) return 1;
+    static const char zeros[BLOCK_SIZE];
+    size_t padding = (BLOCK_SIZE - len % BLOCK_SIZE) % BLOCK_SIZE;
+
+    pthread_mutex_lock(&tar->lock);
+    int failed = fwrite(&header, sizeof(header), 1, tar->file) != 1
+        || fwrite(data, 1, len, tar->file) != len
+        || fwrite(zeros, 1, padding, tar->file) != padding;
+    tar->failed |= failed;
+    pthread_mutex_unlock(&tar->lock);
+    return failed;
+}
+
+int tar_writer_finish(tar_writer_t tar) {
+    static const char zeros[2 * BLOCK_SIZE];
+    int failed = tar->failed || fwrite(zeros, 1, sizeof(zeros), tar->file) != sizeof(zeros);
+    pthread_mutex_destroy(&tar->lock);
+    free(tar);
+    return failed;
+}
@@ -0,0 +1,44 @@
+#ifndef MAZE_GEN_TAR_H
+#define MAZE_GEN_TAR_H
+
+#include <stdio.h>  // FILE
+#include <stdlib.h> // size_t
+
+/*
+ * Writes a ustar archive
+ *
+ * Each file is a 512 byte header followed by its contents, padded to a
+ * multiple of 512 bytes, and the archive ends with two blocks of zeros. Files
+ * are added whole, in the order they're added. A writer can be shared by
+ * threads.
+ */
+typedef struct tar_writer* tar_writer_t;
+
+/** Longest name a file can be added under */
+#define TAR_NAME_MAX 255
+
+/**
+ * Start an archive in `file`, which must stay open until
+ * `tar_writer_finish()`
+ *
+ * Return: The writer. Finish with `tar_writer_finish()`
+ */
+tar_writer_t new_tar_writer(FILE* file);
+
+/**
+ * Add a file to the archive
+ *
+ * Return: 0 on success, nonzero if `name` is too long or the file couldn't
+ *   be written
+ */
+int tar_writer_add(tar_writer_t tar, const char* name, const char* data, size_t len);
+
+/**
+ * End the archive and free the writer. The file is left open.
+ *
+ * Return: 0 if every file and the end of the archive were written, nonzero
+ *   otherwise
+ */
+int tar_writer_finish(tar_writer_t tar);
+
+#endif
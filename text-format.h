@@ -4,5 +4,9 @@
 #define WALL '#'
 #define SPACE ' '
 #define PATH '*'
+// Cells of a maze of more than two dimensions with passages out of their layer
+#define LAYER_NEXT '^'
+#define LAYER_PREV 'v'
+#define LAYER_BOTH 'x'
 
 #endif
@@ -0,0 +1,187 @@
+#include "generator.h"
+#include "stats.h"
+#include <pthread.h>
+#include <stdint.h> // SIZE_MAX
+#include <stdlib.h> // malloc(), free()
+
+/* A rectangle of cells, carved independently of the others */
+struct tile {
+    unsigned long r0, r1; // rows [r0, r1)
+    unsigned long c0, c1; // cols [c0, c1)
+    struct rng rng;       // seeded before any carving
+    uint64_t peak_depth;  // how the search went, for stats.h
+    uint64_t visited;
+};
+
+/* Work shared by the carving threads */
+struct tile_work {
+    struct maze* maze;
+    struct tile* tiles;
+    unsigned long num_tiles;
+    unsigned long next;    // the next tile nobody has picked up yet
+    pthread_mutex_t lock;  // protects next
+};
+
+/**
+ * Carve a perfect maze inside a single tile, by depth first search confined
+ * to the tile and backtracking through the parent bits like `gen_grid()`.
+ * Only cells inside the tile are touched, so tiles can be carved concurrently.
+ */
+static void carve_tile(struct maze* maze, struct tile* tile) {
+    grid_cell_t* grid = maze->grid;
+    unsigned long cols = maze->dims_array[1];
+
+    unsigned long r = tile->r0 + (unsigned long)rng_below(&tile->rng, tile->r1 - tile->r0);
+    unsigned long c = tile->c0 + (unsigned long)rng_below(&tile->rng, tile->c1 - tile->c0);
+    grid[r * cols + c] |= GRID_VISITED;
+    uint64_t depth = 0, peak_depth = 0, visited = 1;
+    while (1) {
+        unsigned long node = r * cols + c;
+
+        // find the unvisited neighbors
+        unsigned choices[4];
+        unsigned num_choices = 0;
+        if (r + 1 < tile->r1 && !(grid[node + cols] & GRID_VISITED)) choices[num_choices++] = DIR_PLUS(0);
+        if (r > tile->r0 && !(grid[node - cols] & GRID_VISITED)) choices[num_choices++] = DIR_MINUS(0);
+        if (c + 1 < tile->c1 && !(grid[node + 1] & GRID_VISITED)) choices[num_choices++] = DIR_PLUS(1);
+        if (c > tile->c0 && !(grid[node - 1] & GRID_VISITED)) choices[num_choices++] = DIR_MINUS(1);
+
+        unsigned dir;
+        if (num_choices == 0) {
+            // backtrack, or stop once we're back at the start
+            if (!GRID_HAS_PARENT(grid[node])) break;
+            dir = GRID_PARENT_DIR(grid[node]);
+            depth--;
+        } else {
+            dir = choices[rng_below(&tile->rng, num_choices)];
+        }
+
+        switch (dir) {
+            case DIR_PLUS(0): r++; break;
+            case DIR_MINUS(0): r--; break;
+            case DIR_PLUS(1): c++; break;
+            default: c--; break;
+        }
+
+        if (num_choices > 0) {
+            // remove the wall and mark as visited
+            grid[node] |= GRID_PASSAGE(dir);
+            grid[r * cols + c] |= GRID_PASSAGE(DIR_OPPOSITE(dir)) | GRID_PARENT(DIR_OPPOSITE(dir)) | GRID_VISITED;
+            visited++;
+            if (++depth > peak_depth) peak_depth = depth;
+        }
+    }
+    tile->peak_depth = peak_depth;
+    tile->visited = visited;
+}
+
+// Thread entry point: carve tiles until there are none left
+static void* carve_tiles(void* arg) {
+    struct tile_work* work = arg;
+    while (1) {
+        pthread_mutex_lock(&work->lock);
+        unsigned long t = work->next++;
+        pthread_mutex_unlock(&work->lock);
+        if (t >= work->num_tiles) break;
+        carve_tile(work->maze, &work->tiles[t]);
+    }
+    return NULL;
+}
+
+// Open the wall between two cells of a 2d grid maze, in direction `dir` from `index`
+static void open_wall(struct maze* maze, unsigned long index, unsigned dir) {
+    unsigned long neigh;
+    maze_neighbor(maze, index, dir, &neigh);
+    maze->grid[index] |= GRID_PASSAGE(dir);
+    maze->grid[neigh] |= GRID_PASSAGE(DIR_OPPOSITE(dir));
+}
+
+// generate a 2d maze with 4-connected neighbors, a tile at a time
+struct maze* gen_maze_4_tiled(unsigned long rows, unsigned long cols, unsigned long tile_size, unsigned threads, struct rng* rng) {
+    unsigned long dims_array[] = {rows, cols};
+    struct maze* out = alloc_grid(2, dims_array);
+    if (!out) return NULL;
+
+    unsigned long tile_rows = (rows + tile_size - 1) / tile_size;
+    unsigned long tile_cols = (cols + tile_size - 1) / tile_size;
+    unsigned long tile_dims[] = {tile_rows, tile_cols};
+    struct tile_work work;
+    work.maze = out;
+    if (maze_cell_count(2, tile_dims, &work.num_tiles) || work.num_tiles > SIZE_MAX / sizeof(struct tile)) {
+        clean_maze(out);
+        return NULL;
+    }
+    work.tiles = stats_malloc(work.num_tiles * sizeof(struct tile));
+    if (!work.tiles) {
+        clean_maze(out);
+        return NULL;
+    }
+    work.next = 0;
+
+    // Each tile's seed is drawn here, in tile order, so the maze doesn't
+    // depend on which thread carves which tile
+    for (unsigned long t = 0; t < work.num_tiles; t++) {
+        struct tile* tile = &work.tiles[t];
+        tile->r0 = t / tile_cols * tile_size;
+        tile->c0 = t % tile_cols * tile_size;
+        tile->r1 = tile->r0 + tile_size < rows ? tile->r0 + tile_size : rows;
+        tile->c1 = tile->c0 + tile_size < cols ? tile->c0 + tile_size : cols;
+        rng_seed(&tile->rng, rng_next(rng));
+    }
+
+    // The tiles are joined along a spanning tree of their own, which is just
+    // a maze with a cell per tile. It isn't part of the maze, so none of it
+    // is recorded.
+    STATS_PAUSE(stats);
+    struct maze* joins = alloc_grid(2, tile_dims);
+    if (joins) {
+        unsigned long start_coords[2];
+        start_coords[0] = (unsigned long)rng_below(rng, tile_rows);
+        start_coords[1] = (unsigned long)rng_below(rng, tile_cols);
+        gen_grid(joins, cell_index(joins, start_coords), 0, rng, NULL, NULL);
+    }
+    STATS_RESUME(stats);
+    if (!joins) {
+        stats_free(work.tiles);
+        clean_maze(out);
+        return NULL;
+    }
+    pthread_mutex_init(&work.lock, NULL);
+
+    // Carve every tile
+    STATS_PHASE_START(timer);
+    if (threads < 1) threads = 1;
+    pthread_t* workers = stats_malloc(threads * sizeof(pthread_t));
+    unsigned started = 0;
+    for (; workers && started < threads; started++) {
+        if (pthread_create(&workers[started], NULL, carve_tiles, &work) != 0) break;
+    }
+    // If no threads could be started, carve on this one
+    if (started == 0) carve_tiles(&work);
+    for (unsigned i = 0; i < started; i++) pthread_join(workers[i], NULL);
+    stats_free(workers);
+    pthread_mutex_destroy(&work.lock);
+
+    // Open one random wall on the border of each pair of joined tiles. The
+    // tiles are each a tree, and they're joined as a tree, so the whole maze
+    // is a tree.
+    for (unsigned long t = 0; t < work.num_tiles; t++) {
+        struct tile* tile = &work.tiles[t];
+        STATS_SEARCH(tile->peak_depth, tile->visited);
+        if (joins->grid[t] & GRID_PASSAGE(DIR_PLUS(0))) {
+            unsigned long c = tile->c0 + (unsigned long)rng_below(rng, tile->c1 - tile->c0);
+            open_wall(out, (tile->r1 - 1) * cols + c, DIR_PLUS(0));
+        }
+        if (joins->grid[t] & GRID_PASSAGE(DIR_PLUS(1))) {
+            unsigned long r = tile->r0 + (unsigned long)rng_below(rng, tile->r1 - tile->r0);
+            open_wall(out, r * cols + tile->c1 - 1, DIR_PLUS(1));
+        }
+    }
+    STATS_PHASE_END(MAZE_PHASE_CARVE, timer);
+
+    STATS_PAUSE(join_stats);
+    clean_maze(joins);
+    STATS_RESUME(join_stats);
+    stats_free(work.tiles);
+    return out;
+}
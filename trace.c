@@ -0,0 +1,199 @@
+#define _POSIX_C_SOURCE 200112L // mmap(), fstat()
+
+#include "trace.h"
+#include <fcntl.h>    // open()
+#include <string.h>   // memcmp()
+#include <sys/mman.h> // mmap(), munmap()
+#include <sys/stat.h> // fstat()
+#include <unistd.h>   // close()
+
+#define HEADER_SIZE(dims) (24 + 8 * (size_t)(dims))
+
+// Events are gathered here and written in chunks
+#define BUFFER_SIZE 65536
+
+/* State for a trace being recorded */
+struct trace_writer {
+    FILE* file;
+    uint64_t seed;
+    unsigned algorithm;
+    unsigned long previous; // the cell of the last step, or NO_CELL before the first
+    size_t used;            // how much of `buffer` is filled
+    unsigned char buffer[BUFFER_SIZE];
+};
+
+// Write `value` as `size` little endian bytes
+static void write_le(FILE* file, uint64_t value, unsigned size) {
+    for (unsigned i = 0; i < size; i++) {
+        fputc((int)(value & 0xFF), file);
+        value >>= 8;
+    }
+}
+
+// Read `size` little endian bytes
+static uint64_t read_le(const unsigned char* bytes, unsigned size) {
+    uint64_t value = 0;
+    for (unsigned i = size; i-- > 0;) value = (value << 8) | bytes[i];
+    return value;
+}
+
+struct trace_writer* new_trace_writer(FILE* file, uint64_t seed, unsigned algorithm) {
+    struct trace_writer* writer = malloc(sizeof(struct trace_writer));
+    writer->file = file;
+    writer->seed = seed;
+    writer->algorithm = algorithm;
+    writer->previous = NO_CELL;
+    writer->used = 0;
+    return writer;
+}
+
+static void write_header(struct trace_writer* writer, const struct maze* maze, unsigned long start) {
+    fwrite(TRACE_MAGIC, 1, 4, writer->file);
+    write_le(writer->file, TRACE_VERSION, 1);
+    write_le(writer->file, writer->algorithm, 1);
+    write_le(writer->file, maze->dims, 1);
+    write_le(writer->file, 0, 1);
+    write_le(writer->file, writer->seed, 8);
+    for (unsigned d = 0; d < maze->dims; d++) write_le(writer->file, maze->dims_array[d], 8);
+    write_le(writer->file, start, 8);
+}
+
+static void push_event(struct trace_writer* writer, unsigned char event) {
+    if (writer->used == BUFFER_SIZE) {
+        fwrite(writer->buffer, 1, writer->used, writer->file);
+        writer->used = 0;
+    }
+    writer->buffer[writer->used++] = event;
+}
+
+// Whether the search went from `from` back to its parent `to`
+static int is_backtrack(const struct maze* maze, unsigned long from, unsigned long to, unsigned dir) {
+    if (maze->grid) {
+        return GRID_HAS_PARENT(maze->grid[from]) && GRID_PARENT_DIR(maze->grid[from]) == dir;
+    }
+    return maze->cells[from].parent == &maze->cells[to];
+}
+
+void trace_step(void* ctx, const struct maze* maze, unsigned long current, unsigned int step) {
+    struct trace_writer* writer = ctx;
+    if (current == NO_CELL) {
+        // The step after the search is over
+        if (writer->previous != NO_CELL) push_event(writer, TRACE_END);
+        return;
+    }
+    if (writer->previous == NO_CELL) {
+        write_header(writer, maze, current);
+        writer->previous = current;
+        return;
+    }
+
+    // Neighbors are a stride apart. Dimensions of size 1 can't be moved along,
+    // so they're skipped, as their stride matches the next dimension's.
+    unsigned long previous = writer->previous;
+    unsigned dir = 0;
+    for (unsigned d = 0; d < maze->dims; d++) {
+        if (maze->dims_array[d] < 2) continue;
+        if (current == previous + maze->strides[d]) {
+            dir = DIR_PLUS(d);
+            break;
+        } else if (current == previous - maze->strides[d]) {
+            dir = DIR_MINUS(d);
+            break;
+        }
+    }
+    push_event(writer, is_backtrack(maze, previous, current, dir) ? TRACE_BACKTRACK : (unsigned char) dir);
+    writer->previous = current;
+}
+
+int trace_writer_finish(struct trace_writer* writer) {
+    fwrite(writer->buffer, 1, writer->used, writer->file);
+    int err = ferror(writer->file);
+    free(writer);
+    return err;
+}
+
+int open_trace_file(const char* path, struct trace_file* file) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return MAZEFILE_ERR_OPEN;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return MAZEFILE_ERR_OPEN;
+    }
+    file->length = (size_t) st.st_size;
+    if (file->length < HEADER_SIZE(0)) {
+        close(fd);
+        return MAZEFILE_ERR_NOT_MAZE;
+    }
+
+    file->map = mmap(NULL, file->length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (file->map == MAP_FAILED) return MAZEFILE_ERR_OPEN;
+
+    const unsigned char* bytes = file->map;
+    int err = 0;
+    if (memcmp(bytes, TRACE_MAGIC, 4) != 0) {
+        err = MAZEFILE_ERR_NOT_MAZE;
+    } else if (bytes[4] != TRACE_VERSION || bytes[6] == 0 || bytes[6] > MAZEFILE_MAX_DIMS
+            || file->length < HEADER_SIZE(bytes[6])) {
+        err = MAZEFILE_ERR_CORRUPT;
+    } else {
+        file->algorithm = bytes[5];
+        file->dims = bytes[6];
+        file->seed = read_le(bytes + 8, 8);
+
+        uint64_t cells = 1;
+        for (unsigned d = 0; d < file->dims && !err; d++) {
+            uint64_t size = read_le(bytes + 16 + 8 * d, 8);
+            file->dims_array[d] = (unsigned long) size;
+            if (size == 0 || size != file->dims_array[d] || cells > UINT64_MAX / size) {
+                err = MAZEFILE_ERR_CORRUPT;
+            } else {
+                cells *= size;
+            }
+        }
+        uint64_t start = read_le(bytes + 16 + 8 * file->dims, 8);
+        if (!err && start >= cells) err = MAZEFILE_ERR_CORRUPT;
+        file->start = (unsigned long) start;
+
+        file->events = bytes + HEADER_SIZE(file->dims);
+        file->num_events = file->length - HEADER_SIZE(file->dims);
+        file->finished = file->num_events > 0 && file->events[file->num_events - 1] == TRACE_END;
+        if (file->finished) file->num_events--;
+    }
+
+    if (err) munmap(file->map, file->length);
+    return err;
+}
+
+void close_trace_file(struct trace_file* file) {
+    munmap(file->map, file->length);
+}
+
+struct maze* trace_start(const struct trace_file* file) {
+    unsigned long dims_array[MAZEFILE_MAX_DIMS];
+    for (unsigned d = 0; d < file->dims; d++) dims_array[d] = file->dims_array[d];
+    struct maze* maze = alloc_grid(file->dims, dims_array);
+    if (maze) maze->grid[file->start] |= GRID_VISITED;
+    return maze;
+}
+
+int trace_apply(struct maze* maze, unsigned long* current, unsigned char event) {
+    grid_cell_t* grid = maze->grid;
+    unsigned long neigh;
+    if (event == TRACE_BACKTRACK) {
+        if (!GRID_HAS_PARENT(grid[*current])) return 1;
+        maze_neighbor(maze, *current, GRID_PARENT_DIR(grid[*current]), current);
+        return 0;
+    }
+
+    unsigned dir = event;
+    if (dir >= 2 * maze->dims || !maze_neighbor(maze, *current, dir, &neigh) || (grid[neigh] & GRID_VISITED)) {
+        return 1;
+    }
+    grid[*current] |= GRID_PASSAGE(dir);
+    grid[neigh] |= GRID_PASSAGE(DIR_OPPOSITE(dir)) | GRID_PARENT(DIR_OPPOSITE(dir)) | GRID_VISITED;
+    *current = neigh;
+    return 0;
+}
@@ -0,0 +1,120 @@
+#ifndef MAZE_GEN_TRACE_H
+#define MAZE_GEN_TRACE_H
+
+#include "generator.h"
+#include "mazefile.h" // MAZEFILE_MAX_DIMS
+#include <stdint.h>   // uint64_t
+#include <stdio.h>    // FILE
+#include <stdlib.h>   // size_t
+
+/*
+ * The step trace format
+ *
+ * A record of a depth first search, a byte per step, so any step of the
+ * generation can be rendered later without writing an image per step while
+ * generating. All integers are little endian.
+ *
+ * | offset        | size     | contents                                 |
+ * |---------------|----------|------------------------------------------|
+ * | 0             | 4        | magic, "MAZT"                            |
+ * | 4             | 1        | format version, `TRACE_VERSION`          |
+ * | 5             | 1        | algorithm, as in mazefile.h              |
+ * | 6             | 1        | number of dimensions, `dims`             |
+ * | 7             | 1        | reserved, 0                              |
+ * | 8             | 8        | seed the maze was generated with         |
+ * | 16            | 8 * dims | size of each dimension                   |
+ * | 16 + 8 * dims | 8        | index of the cell the search started at  |
+ * | ...           | 1 each   | events                                   |
+ *
+ * An event below `2 * dims` is a direction (see `DIR_PLUS()`): the search
+ * carved a passage that way and moved into the new cell. `TRACE_BACKTRACK`
+ * means it went back to the current cell's parent, and `TRACE_END` that
+ * generation finished. A trace without `TRACE_END` was cut short.
+ *
+ * Steps are numbered like the calls to a `step_func_t`: step 0 is before the
+ * search starts, step 1 is at the starting cell, step `n + 1` is after the
+ * `n`th event, and the step after the last event is the finished maze.
+ */
+
+#define TRACE_MAGIC "MAZT"
+#define TRACE_VERSION 1
+#define TRACE_BACKTRACK 0xFF
+#define TRACE_END 0xFE
+
+/** Records a trace. Its `trace_step()` is passed as a generator's step function. */
+typedef struct trace_writer* trace_writer_t;
+
+/**
+ * Start recording a trace to `file`
+ * The header is written once the maze's shape is known, on the first step.
+ *
+ * Return: The new writer. Finish with `trace_writer_finish()`
+ */
+trace_writer_t new_trace_writer(FILE* file, uint64_t seed, unsigned algorithm);
+
+/**
+ * Record a step. Matches `step_func_t`, with the writer as `ctx`.
+ * Successive steps must be neighbors, as they are in the depth first
+ * generators.
+ */
+void trace_step(void* writer, const struct maze* maze, unsigned long current, unsigned int step);
+
+/**
+ * Flush the trace and free the writer. Doesn't close the file.
+ *
+ * Return: 0 on success, nonzero on failure
+ */
+int trace_writer_finish(trace_writer_t writer);
+
+/** A trace mapped into memory */
+struct trace_file {
+    unsigned dims;
+    unsigned long dims_array[MAZEFILE_MAX_DIMS];
+    uint64_t seed;
+    unsigned algorithm;
+    unsigned long start;
+    /** The events, not including `TRACE_END` */
+    const unsigned char* events;
+    size_t num_events;
+    /** Whether the trace ends with `TRACE_END` */
+    int finished;
+    /** The whole mapping */
+    void* map;
+    size_t length;
+};
+
+/**
+ * Map a trace into memory, after checking its header
+ *
+ * Return: 0 on success, or one of the `MAZEFILE_ERR_*` codes. Only on
+ *   success must the file be closed with `close_trace_file()`.
+ */
+int open_trace_file(const char* path, struct trace_file* file);
+
+/**
+ * Unmap a trace
+ */
+void close_trace_file(struct trace_file* file);
+
+/**
+ * Allocate the maze a trace is replayed onto, with just the starting cell
+ * visited. The maze is at step 1.
+ *
+ * Return: A grid maze, or NULL if the trace has more than `GRID_MAX_DIMS`
+ *   dimensions. Deallocate using `clean_maze()`
+ */
+struct maze* trace_start(const struct trace_file* file);
+
+/**
+ * Apply an event to a maze from `trace_start()`
+ *
+ * Args:
+ * - maze: the maze being replayed onto
+ * - current: the cell the search is at, updated
+ * - event: the event to apply
+ *
+ * Return: 0 on success, nonzero if the event isn't possible from here
+ */
+int trace_apply(struct maze* maze, unsigned long* current, unsigned char event);
+
+#endif
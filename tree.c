@@ -7,6 +7,7 @@ struct tree {
     compare_func_t compare; // user defined compare function used to determine
                             // whether to place something in the left or the
                             // right child, or to detect duplicates
+    pool_t pool;            // where nodes come from. NULL to use malloc()
 };
 
 /* A tree node */
@@ -17,12 +18,30 @@ struct tree_node {
 };
 
 struct tree* new_tree(compare_func_t compare) {
-    struct tree* tree = malloc(sizeof(struct tree_node));
+    return new_tree_pool(compare, NULL);
+}
+
+struct tree* new_tree_pool(compare_func_t compare, pool_t pool) {
+    struct tree* tree = malloc(sizeof(struct tree));
     tree->root = NULL;
     tree->compare = compare;
+    tree->pool = pool;
     return tree;
 }
 
+size_t tree_node_size(void) {
+    return sizeof(struct tree_node);
+}
+
+// Release a node to wherever it came from
+static void free_node(struct tree* tree, struct tree_node* node) {
+    if (tree->pool) {
+        pool_free(tree->pool, node);
+    } else {
+        free(node);
+    }
+}
+
 /*
 static struct tree_node* add(struct tree_node* node, void* data, compare_func_t compare) {
     if  (node == NULL) {
@@ -65,7 +84,7 @@ void tree_add(struct tree* tree, void* data) {
         }
     }
 
-    struct tree_node* new_node = malloc(sizeof(struct tree_node));
+    struct tree_node* new_node = tree->pool ? pool_alloc(tree->pool) : malloc(sizeof(struct tree_node));
     new_node->data = data;
     new_node->left = NULL;
     new_node->right = NULL;
@@ -108,18 +127,18 @@ int tree_contains(struct tree* tree, void* data) {
     return 0;
 }
 
-static void deallocate(struct tree_node* node) {
+static void deallocate(struct tree* tree, struct tree_node* node) {
     if (node == NULL) {
         return;
     }
 
-    deallocate(node->left);
-    deallocate(node->right);
-    free(node);
+    deallocate(tree, node->left);
+    deallocate(tree, node->right);
+    free_node(tree, node);
 }
 
 void tree_deallocate(struct tree* tree) {
-    deallocate(tree->root);
+    deallocate(tree, tree->root);
     free(tree);
 }
 
@@ -176,7 +195,7 @@ void* tree_pop(tree_t tree) {
             current = current->right;
         } else {
             void* data = current->data;
-            free(current);
+            free_node(tree, current);
             *last = NULL;
             return data;
         }
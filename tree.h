@@ -2,6 +2,7 @@
 #define MAZE_GEN_TREE_H
 
 #include <stdint.h> // intmax_t
+#include "pool.h"
 
 /**
  * A compare function.
@@ -19,6 +20,17 @@ typedef struct tree* tree_t;
  */
 tree_t new_tree(compare_func_t compare);
 
+/**
+ * Instantiate a new tree that takes its nodes from `pool`
+ * The pool must have been created with `tree_node_size()`.
+ */
+tree_t new_tree_pool(compare_func_t compare, pool_t pool);
+
+/**
+ * The size of a tree node, for creating a pool with `new_pool()`
+ */
+size_t tree_node_size(void);
+
 /**
  * Adds a new node to the tree.
  * Note: this will deduplicate nodes that the compare function indicates are the same.
@@ -1,65 +1,160 @@
-#include <img.h>
-#include <stdlib.h> // free(), calloc()
-#include <stdio.h> // file handling
+#define _POSIX_C_SOURCE 200112L // mmap(), fstat(), posix_madvise()
+
+#include <fcntl.h>    // open()
+#include <stdlib.h>   // free(), malloc()
+#include <stdio.h>    // file handling
+#include <string.h>   // memchr()
+#include <sys/mman.h> // mmap(), munmap()
+#include <sys/stat.h> // fstat()
+#include <unistd.h>   // close()
 
 #include "text-format.h"
+#include "mazefile.h"
+#include "raster.h"
+#include "png_writer.h"
 
-// argv[0]: input text file
-// argv[1]: output png file
-int main(int argc, char** argv) {
-    FILE* file = fopen(argv[1], "r");
-    int rows = 0;
-    int cols = 0;
+// Convert a two dimensional binary maze straight to a png, a row at a time
+static int bin_to_png(const struct maze_file* maze, const char* out_path) {
+    if (maze->dims != 2) {
+        fprintf(stderr, "Error: only two dimensional mazes can be converted\n");
+        return 1;
+    }
+    unsigned long rows = maze->dims_array[0];
+    unsigned long cols = maze->dims_array[1];
 
-    int ch;
+    FILE* out = fopen(out_path, "wb");
+    if (!out) {
+        fprintf(stderr, "Error: couldn't open `%s` for writing\n", out_path);
+        return 1;
+    }
+    png_writer_t writer = new_png_writer(out, RASTER_WIDTH(cols), RASTER_HEIGHT(rows));
+    if (!writer) {
+        fprintf(stderr, "Error: couldn't start a png for a %lux%lu maze\n", rows, cols);
+        fclose(out);
+        return 1;
+    }
 
-    while ((ch = fgetc(file)) != EOF) {
-        if (ch == '\n') {
-            rows++;
-        }
-        if (rows == 0) {
-            cols++;
-        }
+    unsigned char* row = malloc(cols);
+    char* line = malloc(RASTER_WIDTH(cols));
+    raster_border(line, cols);
+    int err = png_writer_line(writer, line);
+    for (unsigned long r = 0; r < rows && !err; r++) {
+        maze_file_row(maze, r, row);
+        raster_cells(line, row, cols, 1);
+        err = png_writer_line(writer, line);
+        raster_south(line, row, cols);
+        err = err || png_writer_line(writer, line);
     }
+    free(line);
+    free(row);
 
-    fseek(file, 0, SEEK_SET);
-    
-    struct img img;
-    img.height = rows;
-    img.width = cols;
-    img.rows = calloc((size_t)img.height, sizeof(struct pixel*));
-    for (int r = 0; r < img.height; r++) {
-        img.rows[r] = calloc((size_t)img.width, sizeof(struct pixel));
-        for (int c = 0; c < img.width; c++) {
-            ch = fgetc(file);
+    err = png_writer_finish(writer) || err;
+    err = fclose(out) || err;
+    if (err) fprintf(stderr, "Error: failed to write `%s`\n", out_path);
+    return err;
+}
 
-            // Skip newlines
-            if (ch == '\n') {
-                c--;
-                continue;
-            }
+/**
+ * Convert a text maze to a png in a single pass
+ * The text is mapped rather than read, and each line goes straight to the png
+ * writer, so only a line of pixels is ever held. Every line must be as long
+ * as the first. The newline after the last one is optional.
+ *
+ * Return: 0 on success, nonzero on failure
+ */
+static int text_to_png(const char* in_path, const char* out_path) {
+    int fd = open(in_path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error: couldn't open `%s`\n", in_path);
+        return 1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        fprintf(stderr, "Error: `%s` is empty, or not a file\n", in_path);
+        close(fd);
+        return 1;
+    }
+    size_t length = (size_t) st.st_size;
+    const char* text = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (text == MAP_FAILED) {
+        fprintf(stderr, "Error: couldn't map `%s`\n", in_path);
+        return 1;
+    }
+    // Read front to back once, so the kernel can read ahead and drop behind
+    posix_madvise((void*) text, length, POSIX_MADV_SEQUENTIAL);
 
-            // It might be a wall. More on that later.
-            if (ch == WALL) {
-                img.rows[r][c].red = 0;
-                img.rows[r][c].green = 0;
-                img.rows[r][c].blue = 0;
-            } else if (ch == PATH) {
-                img.rows[r][c].red = 255;
-                img.rows[r][c].green = 0;
-                img.rows[r][c].blue = 0;
-            } else if (ch == SPACE) {
-                img.rows[r][c].red = 255;
-                img.rows[r][c].green = 255;
-                img.rows[r][c].blue = 255;
+    // The width comes from the first line and the height from counting the
+    // lines, which the png header needs up front. Each line is checked as it's
+    // converted.
+    const char* newline = memchr(text, '\n', length);
+    size_t width = newline ? (size_t) (newline - text) : length;
+    if (width == 0) {
+        fprintf(stderr, "Error: the first line of `%s` is empty\n", in_path);
+        munmap((void*) text, length);
+        return 1;
+    }
+    size_t height = text[length - 1] != '\n';
+    for (const char* c = text; (c = memchr(c, '\n', length - (size_t) (c - text))) != NULL; c++) height++;
+
+    int err = 1;
+    FILE* out = fopen(out_path, "wb");
+    png_writer_t writer = out ? new_png_writer(out, width, height) : NULL;
+    if (!out) {
+        fprintf(stderr, "Error: couldn't open `%s` for writing\n", out_path);
+    } else if (!writer) {
+        fprintf(stderr, "Error: couldn't start a png for a %zux%zu image\n", width, height);
+        fclose(out);
+    } else {
+        err = 0;
+        const char* line = text;
+        for (size_t y = 0; y < height && !err; y++) {
+            // Only the last line can run up to the end of the file instead
+            size_t left = length - (size_t) (line - text);
+            const char* end = memchr(line, '\n', left);
+            if (!end) end = line + left;
+            if ((size_t) (end - line) != width) {
+                fprintf(stderr, "Error: line %zu of `%s` isn't %zu characters long like the first\n", y + 1, in_path, width);
+                err = 2;
+            } else {
+                err = png_writer_line(writer, line);
             }
+            line = end + 1;
+        }
+        if (err == 2) {
+            // The bad line has been reported, and the png can't be finished
+            png_writer_abandon(writer);
+            fclose(out);
+            remove(out_path);
+        } else {
+            err = png_writer_finish(writer) || err;
+            err = fclose(out) || err;
+            if (err) fprintf(stderr, "Error: failed to write `%s`\n", out_path);
         }
     }
 
-    writepng(argv[2], &img);
+    munmap((void*) text, length);
+    return err;
+}
 
-    // Free the image
-    for (int r = 0; r < img.height; r++) free(img.rows[r]);
-    free(img.rows);
-    fclose(file);
+// argv[1]: input text file, or binary maze
+// argv[2]: output png file
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s input output.png\n", argv[0]);
+        return 2;
+    }
+
+    // Binary mazes are mapped and converted directly
+    struct maze_file maze;
+    int status = open_maze_file(argv[1], &maze);
+    if (status == 0) {
+        status = bin_to_png(&maze, argv[2]);
+        close_maze_file(&maze);
+        return status;
+    } else if (status == MAZEFILE_ERR_CORRUPT) {
+        fprintf(stderr, "Error: `%s` is a corrupt binary maze\n", argv[1]);
+        return 1;
+    }
+    return text_to_png(argv[1], argv[2]) != 0;
 }
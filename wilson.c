@@ -0,0 +1,67 @@
+#include "algorithms.h"
+#include "stats.h"
+
+// Overwrite the parent bits of a cell
+static void set_parent(grid_cell_t* cell, unsigned dir) {
+    *cell = (grid_cell_t)((*cell & ~GRID_PARENT_MASK) | GRID_PARENT(dir));
+}
+
+void carve_wilson(struct maze* maze, unsigned long limit, struct rng* rng, step_func_t write_step, void* step_ctx) {
+    unsigned int step = 0;
+    if (write_step) write_step(step_ctx, maze, NO_CELL, step++);
+    STATS_PHASE_START(timer);
+    grid_cell_t* grid = maze->grid;
+    unsigned dirs = 2 * maze->dims;
+    uint64_t peak_walk = 0, visited = 1;
+
+    unsigned long root = (unsigned long) rng_below(rng, maze->size);
+    grid[root] |= GRID_VISITED;
+    if (write_step) write_step(step_ctx, maze, root, step++);
+
+    for (unsigned long cell = 0; cell < maze->size && !(limit && visited >= limit); cell++) {
+        if (grid[cell] & GRID_VISITED) continue;
+
+        // Walk until the maze is hit, leaving the way out of each cell in its
+        // parent bits. Coming back to a cell overwrites its way out, which
+        // erases the loop.
+        unsigned long walker = cell;
+        uint64_t walk = 0;
+        while (!(grid[walker] & GRID_VISITED)) {
+            unsigned dir;
+            unsigned long next;
+            do {
+                dir = (unsigned) rng_below(rng, dirs);
+            } while (!maze_neighbor(maze, walker, dir, &next));
+            set_parent(&grid[walker], dir);
+            walker = next;
+            walk++;
+        }
+        if (walk > peak_walk) peak_walk = walk;
+
+        // Carve what's left of the walk into the maze
+        walker = cell;
+        while (!(grid[walker] & GRID_VISITED)) {
+            unsigned dir = GRID_PARENT_DIR(grid[walker]);
+            unsigned long next;
+            maze_neighbor(maze, walker, dir, &next);
+            grid[walker] &= (grid_cell_t) ~GRID_PARENT_MASK;
+            // Past the limit, the rest of the walk is just tidied up
+            if (!limit || visited < limit) {
+                grid[walker] |= GRID_PASSAGE(dir) | GRID_VISITED;
+                grid[next] |= GRID_PASSAGE(DIR_OPPOSITE(dir));
+                visited++;
+                if (write_step) write_step(step_ctx, maze, walker, step++);
+            }
+            walker = next;
+        }
+    }
+
+    // Stopping early can leave erased walks behind
+    if (limit && visited < maze->size) {
+        for (unsigned long i = 0; i < maze->size; i++) grid[i] &= (grid_cell_t) ~GRID_PARENT_MASK;
+    }
+
+    STATS_SEARCH(peak_walk, visited);
+    STATS_PHASE_END(MAZE_PHASE_CARVE, timer);
+    if (write_step) write_step(step_ctx, maze, NO_CELL, step++);
+}